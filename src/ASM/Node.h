@@ -224,4 +224,13 @@ struct RetInst : public Instruction {
 	void accept(ASM::ASMBaseVisitor *visitor) override { visitor->visitRetInst(this); }
 };
 
+/// @brief a call in tail position: the frame is released as by a ret, then the callee returns to our caller
+struct TailCallInst : public RetInst {
+	using RetInst::RetInst;
+	std::string funcName;
+	std::set<Reg *> use;
+	void print(std::ostream &os) const override;
+	std::set<Reg *> getUse() const override { return use; }
+};
+
 }// namespace ASM
@@ -119,14 +119,23 @@ void BranchInst::print(std::ostream &os) const {
 	os << "b" << op << '\t' << rs1->name << ", " << rs2->name << ", " << dst->label;
 }
 
-void RetInst::print(std::ostream &os) const {
+static void print_epilogue(std::ostream &os, Function *func) {
 	if (func->max_call_arg_size >= 0)
 		os << "lw ra, " << func->stack.front()->offset << "(sp)\n\t";
 	if (int sp_size = func->get_total_stack(); sp_size > 0)
 		os << "addi sp, sp, " << sp_size << "\n\t";
+}
+
+void RetInst::print(std::ostream &os) const {
+	print_epilogue(os, func);
 	os << "ret";
 }
 
+void TailCallInst::print(std::ostream &os) const {
+	print_epilogue(os, func);
+	os << "tail\t" << funcName;
+}
+
 void LuiInst::print(std::ostream &os) const {
 	os << "lui\t" << rd->name << ", " << imm->to_string();
 }
@@ -0,0 +1,75 @@
+#include "Cloner.h"
+
+namespace IR {
+
+Val *Cloner::operator()(Val *v) const {
+	auto p = val.find(v);
+	return p == val.end() ? v : p->second;
+}
+
+Var *Cloner::operator()(Var *v) const {
+	return dynamic_cast<Var *>((*this)(static_cast<Val *>(v)));
+}
+
+BasicBlock *Cloner::operator()(BasicBlock *b) const {
+	auto p = block.find(b);
+	return p == block.end() ? b : p->second;
+}
+
+Var *Cloner::fresh(Var *var) {
+	Var *res;
+	if (auto ptr = dynamic_cast<PtrVar *>(var))
+		res = env.create_annoy_ptr_var(ptr->objType, prefix);
+	else
+		res = env.create_annoy_var(var->type, prefix);
+	val[var] = res;
+	return res;
+}
+
+Stmt *Cloner::clone(Stmt *stmt) {
+	auto def = [&](Var *var) {
+		auto p = val.find(var);
+		return p == val.end() ? fresh(var) : dynamic_cast<Var *>(p->second);
+	};
+	if (auto alloca = dynamic_cast<AllocaStmt *>(stmt))
+		return env.createAllocaStmt(dynamic_cast<PtrVar *>(def(alloca->res)));
+	if (auto store = dynamic_cast<StoreStmt *>(stmt))
+		return env.createStoreStmt((*this)(store->value), (*this)(store->pointer));
+	if (auto load = dynamic_cast<LoadStmt *>(stmt))
+		return env.createLoadStmt(def(load->res), (*this)(load->pointer));
+	if (auto arith = dynamic_cast<ArithmeticStmt *>(stmt))
+		return env.createArithmeticStmt(arith->cmd, def(arith->res), (*this)(arith->lhs), (*this)(arith->rhs));
+	if (auto icmp = dynamic_cast<IcmpStmt *>(stmt))
+		return env.createIcmpStmt(icmp->cmd, def(icmp->res), (*this)(icmp->lhs), (*this)(icmp->rhs));
+	if (auto select = dynamic_cast<SelectStmt *>(stmt))
+		return env.createSelectStmt(def(select->res), (*this)(select->cond), (*this)(select->trueVal), (*this)(select->falseVal));
+	if (auto gep = dynamic_cast<GetElementPtrStmt *>(stmt)) {
+		std::vector<Val *> indices;
+		for (auto index: gep->indices)
+			indices.push_back((*this)(index));
+		return env.createGetElementPtrStmt(gep->typeName, def(gep->res), (*this)(gep->pointer), indices);
+	}
+	if (auto call = dynamic_cast<CallStmt *>(stmt)) {
+		std::vector<Val *> args;
+		for (auto arg: call->args)
+			args.push_back((*this)(arg));
+		return env.createCallStmt(call->func, args, call->res ? def(call->res) : nullptr);
+	}
+	if (auto phi = dynamic_cast<PhiStmt *>(stmt)) {
+		auto ret = env.createPhiStmt(def(phi->res));
+		for (auto [from, v]: phi->branches)
+			ret->branches[(*this)(from)] = (*this)(v);
+		return ret;
+	}
+	if (auto ret = dynamic_cast<RetStmt *>(stmt))
+		return ret->value ? env.createRetStmt((*this)(ret->value)) : env.createRetStmt();
+	if (auto direct = dynamic_cast<DirectBrStmt *>(stmt))
+		return env.createDirectBrStmt((*this)(direct->block));
+	if (auto cond = dynamic_cast<CondBrStmt *>(stmt))
+		return env.createCondBrStmt((*this)(cond->cond), (*this)(cond->trueBlock), (*this)(cond->falseBlock));
+	if (dynamic_cast<UnreachableStmt *>(stmt))
+		return env.createUnreachableStmt();
+	throw std::runtime_error("Cloner: unexpected stmt " + stmt->to_string());
+}
+
+}// namespace IR
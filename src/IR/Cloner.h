@@ -0,0 +1,30 @@
+#pragma once
+#include "Wrapper.h"
+#include <map>
+
+namespace IR {
+
+/// @brief copies stmts for passes duplicating code. results get new vars, operands and branch targets are read
+/// through the maps; whatever is not mapped, like a value defined outside the copied blocks, stays the same.
+struct Cloner {
+	Cloner(Wrapper &env, std::string prefix) : env(env), prefix(std::move(prefix)) {}
+
+	std::map<Val *, Val *> val;
+	std::map<BasicBlock *, BasicBlock *> block;
+
+	[[nodiscard]] Val *operator()(Val *v) const;
+	/// @return nullptr if `v` is mapped to a literal
+	[[nodiscard]] Var *operator()(Var *v) const;
+	[[nodiscard]] BasicBlock *operator()(BasicBlock *b) const;
+
+	/// @brief a new var of the same kind as `var`, mapped from it
+	Var *fresh(Var *var);
+	/// @brief the copy of `stmt`, defining the var its result is mapped to or a fresh one
+	Stmt *clone(Stmt *stmt);
+
+private:
+	Wrapper &env;
+	std::string prefix;
+};
+
+}// namespace IR
@@ -26,6 +26,7 @@ struct StoreStmt;
 struct LoadStmt;
 struct ArithmeticStmt;
 struct IcmpStmt;
+struct SelectStmt;
 struct RetStmt;
 struct GetElementPtrStmt;
 struct CallStmt;
@@ -14,6 +14,7 @@ struct IRBaseVisitor {
 	virtual void visitLoadStmt(LoadStmt *node) {}
 	virtual void visitArithmeticStmt(ArithmeticStmt *node) {}
 	virtual void visitIcmpStmt(IcmpStmt *node) {}
+	virtual void visitSelectStmt(SelectStmt *node) {}
 	virtual void visitRetStmt(RetStmt *node) {}
 	virtual void visitGetElementPtrStmt(GetElementPtrStmt *node) {}
 	virtual void visitCallStmt(CallStmt *node) {}
@@ -22,6 +22,17 @@ struct Class : public IRNode {
 struct Stmt : public IRNode {
 	[[nodiscard]] virtual std::set<Val *> getUse() const { return {}; }
 	[[nodiscard]] virtual Var *getDef() const { return nullptr; }
+	/// @brief replace every use of `from` by `to`; pointer operands are kept if `to` is not a Var
+	virtual void replaceUse(Val *from, Val *to) {}
+
+protected:
+	static void replace(Val *&slot, Val *from, Val *to) {
+		if (slot == from) slot = to;
+	}
+	static void replace(Var *&slot, Val *from, Val *to) {
+		if (slot == from)
+			if (auto var = dynamic_cast<Var *>(to)) slot = var;
+	}
 };
 
 struct BasicBlock : public IRNode {
@@ -63,6 +74,7 @@ struct StoreStmt : public Stmt {
 	void print(std::ostream &out) const override;
 	void accept(IRBaseVisitor *visitor) override { visitor->visitStoreStmt(this); }
 	[[nodiscard]] std::set<Val *> getUse() const override { return {pointer, value}; }
+	void replaceUse(Val *from, Val *to) override { replace(value, from, to), replace(pointer, from, to); }
 };
 
 struct LoadStmt : public Stmt {
@@ -72,6 +84,7 @@ struct LoadStmt : public Stmt {
 	void print(std::ostream &out) const override;
 	void accept(IRBaseVisitor *visitor) override { visitor->visitLoadStmt(this); }
 	[[nodiscard]] std::set<Val *> getUse() const override { return {pointer}; }
+	void replaceUse(Val *from, Val *to) override { replace(pointer, from, to); }
 	[[nodiscard]] Var *getDef() const override { return res; }
 };
 
@@ -85,6 +98,7 @@ struct ArithmeticStmt : public Stmt {
 	void print(std::ostream &out) const override;
 	void accept(IRBaseVisitor *visitor) override { visitor->visitArithmeticStmt(this); }
 	[[nodiscard]] std::set<Val *> getUse() const override { return {lhs, rhs}; }
+	void replaceUse(Val *from, Val *to) override { replace(lhs, from, to), replace(rhs, from, to); }
 	[[nodiscard]] Var *getDef() const override { return res; }
 };
 
@@ -98,6 +112,20 @@ struct IcmpStmt : public Stmt {
 	void print(std::ostream &out) const override;
 	void accept(IRBaseVisitor *visitor) override { visitor->visitIcmpStmt(this); }
 	[[nodiscard]] std::set<Val *> getUse() const override { return {lhs, rhs}; }
+	void replaceUse(Val *from, Val *to) override { replace(lhs, from, to), replace(rhs, from, to); }
+	[[nodiscard]] Var *getDef() const override { return res; }
+};
+
+struct SelectStmt : public Stmt {
+	SelectStmt(Var *res, Val *cond, Val *trueVal, Val *falseVal) : res(res), cond(cond), trueVal(trueVal), falseVal(falseVal) {}
+	Var *res = nullptr;
+	Val *cond = nullptr;
+	Val *trueVal = nullptr;
+	Val *falseVal = nullptr;
+	void print(std::ostream &out) const override;
+	void accept(IRBaseVisitor *visitor) override { visitor->visitSelectStmt(this); }
+	[[nodiscard]] std::set<Val *> getUse() const override { return {cond, trueVal, falseVal}; }
+	void replaceUse(Val *from, Val *to) override { replace(cond, from, to), replace(trueVal, from, to), replace(falseVal, from, to); }
 	[[nodiscard]] Var *getDef() const override { return res; }
 };
 
@@ -112,6 +140,7 @@ struct RetStmt : public Stmt {
 		else
 			return {};
 	}
+	void replaceUse(Val *from, Val *to) override { replace(value, from, to); }
 };
 
 struct GetElementPtrStmt : public Stmt {
@@ -130,6 +159,11 @@ struct GetElementPtrStmt : public Stmt {
 			ret.insert(index);
 		return ret;
 	}
+	void replaceUse(Val *from, Val *to) override {
+		replace(pointer, from, to);
+		for (auto &index: indices)
+			replace(index, from, to);
+	}
 	[[nodiscard]] Var *getDef() const override { return res; }
 };
 
@@ -146,6 +180,10 @@ struct CallStmt : public Stmt {
 			ret.insert(arg);
 		return ret;
 	}
+	void replaceUse(Val *from, Val *to) override {
+		for (auto &arg: args)
+			replace(arg, from, to);
+	}
 	[[nodiscard]] Var *getDef() const override { return res; }
 };
 
@@ -166,6 +204,7 @@ struct CondBrStmt : public BrStmt {
 	void print(std::ostream &out) const override;
 	void accept(IRBaseVisitor *visitor) override { visitor->visitCondBrStmt(this); }
 	[[nodiscard]] std::set<Val *> getUse() const override { return {cond}; }
+	void replaceUse(Val *from, Val *to) override { replace(cond, from, to); }
 };
 
 struct PhiStmt : public Stmt {
@@ -180,6 +219,10 @@ struct PhiStmt : public Stmt {
 			ret.insert(val);
 		return ret;
 	}
+	void replaceUse(Val *from, Val *to) override {
+		for (auto &[block, val]: branches)
+			replace(val, from, to);
+	}
 	[[nodiscard]] Var *getDef() const override { return res; }
 };
 
@@ -33,6 +33,7 @@ struct RewriteLayer : public IRBaseVisitor {
 	void visitLoadStmt(LoadStmt *node) override { add_stmt(node); }
 	void visitArithmeticStmt(ArithmeticStmt *node) override { add_stmt(node); }
 	void visitIcmpStmt(IcmpStmt *node) override { add_stmt(node); }
+	void visitSelectStmt(SelectStmt *node) override { add_stmt(node); }
 	void visitRetStmt(RetStmt *node) override { add_stmt(node); }
 	void visitGetElementPtrStmt(GetElementPtrStmt *node) override { add_stmt(node); }
 	void visitCallStmt(CallStmt *node) override { add_stmt(node); }
@@ -65,6 +65,18 @@ IR::GlobalVar *IR::Wrapper::create_global_var(IR::Type *type, std::string name)
 	return var;
 }
 
+IR::LocalVar *IR::Wrapper::create_annoy_var(IR::Type *type, std::string const &prefix) {
+	return create_local_var(type, prefix + std::to_string(annoyCounter[prefix]++));
+}
+
+IR::PtrVar *IR::Wrapper::create_annoy_ptr_var(IR::Type *objType, std::string const &prefix) {
+	return create_ptr_var(objType, prefix + std::to_string(annoyCounter[prefix]++));
+}
+
+IR::BasicBlock *IR::Wrapper::create_annoy_block(std::string const &prefix) {
+	return createBasicBlock(prefix + std::to_string(annoyCounter[prefix]++));
+}
+
 IR::Module *IR::Wrapper::createModule() {
 	if (module) throw std::runtime_error("module already exists");
 	module = new Module{};
@@ -29,6 +29,11 @@ public:
 	PtrVar *create_ptr_var(Type *objType, std::string name);
 	GlobalVar *create_global_var(Type *type, std::string name);
 
+	/// @brief for optimization passes: named `prefix` followed by a counter, unique in the module
+	LocalVar *create_annoy_var(Type *type, std::string const &prefix);
+	PtrVar *create_annoy_ptr_var(Type *objType, std::string const &prefix);
+	BasicBlock *create_annoy_block(std::string const &prefix);
+
 	Module *createModule();
 
 	template<typename... Args>
@@ -80,6 +85,12 @@ public:
 		return node;
 	}
 	template<typename... Args>
+	SelectStmt *createSelectStmt(Args &&...args) {
+		auto node = new SelectStmt{std::forward<Args>(args)...};
+		nodes.emplace_back(node);
+		return node;
+	}
+	template<typename... Args>
 	RetStmt *createRetStmt(Args &&...args) {
 		auto node = new RetStmt{std::forward<Args>(args)...};
 		nodes.emplace_back(node);
@@ -155,6 +166,7 @@ private:
 
 	std::vector<Var *> vars;
 	std::vector<IRNode *> nodes;
+	std::map<std::string, int> annoyCounter;
 };
 
 }// namespace IR
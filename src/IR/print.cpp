@@ -170,6 +170,13 @@ void CondBrStmt::print(std::ostream &out) const {
 	out << ", label %" << trueBlock->label << ", label %" << falseBlock->label;
 }
 
+void SelectStmt::print(std::ostream &out) const {
+	auto type = res->type->to_string();
+	out << res->get_name() << " = select i1 " << cond->get_name() << ", ";
+	out << type << " " << trueVal->get_name() << ", ";
+	out << type << " " << falseVal->get_name();
+}
+
 void IcmpStmt::print(std::ostream &out) const {
 	out << res->get_name() << " = icmp " << cmd << " ";
 	lhs->print(out);
@@ -1,4 +1,6 @@
 #include "InstMaker.h"
+#include <bit>
+#include <climits>
 #include <queue>
 #include <set>
 
@@ -26,8 +28,10 @@ void InstMake::visitFunction(IR::Function *node) {
 		block2block[b] = block;
 		func->blocks.push_back(block);
 	}
-	for (auto b: node->blocks)
-		visitBasicBlock(b);
+	for (auto p = node->blocks.begin(); p != node->blocks.end(); ++p) {
+		nextIRBlock = std::next(p) == node->blocks.end() ? nullptr : *std::next(p);
+		visitBasicBlock(*p);
+	}
 	if (func->max_call_arg_size >= 0) {
 		auto st = add_object_to_stack_front();
 		st->offset = 0;
@@ -71,8 +75,11 @@ void InstMake::visitBasicBlock(IR::BasicBlock *node) {
 	currentIRBlock = node;
 	for (auto [res, phi]: node->phis)
 		visitPhiStmt(phi);
-	for (auto s: node->stmts)
-		visit(s);
+	for (auto p = node->stmts.begin(); p != node->stmts.end(); ++p) {
+		auto call = dynamic_cast<IR::CallStmt *>(*p);
+		if (call && std::next(p) != node->stmts.end() && tail_call(call, *std::next(p))) break;
+		visit(*p);
+	}
 	currentIRBlock = nullptr;
 	currentBlock = nullptr;
 }
@@ -168,6 +175,14 @@ void InstMake::visitArithmeticStmt(IR::ArithmeticStmt *node) {
 		add_inst(inst);
 	}
 	else {
+		auto lhs = node->lhs, rhs = node->rhs;
+		if (node->cmd == "mul" && dynamic_cast<IR::LiteralInt *>(lhs))
+			std::swap(lhs, rhs);
+		if (auto num = dynamic_cast<IR::LiteralInt *>(rhs)) {
+			bool done = node->cmd == "mul" ? mul_by_const(getReg(node->res), getReg(lhs), num->value)
+			                               : div_by_const(getReg(node->res), getReg(lhs), num->value, node->cmd == "srem");
+			if (done) return;
+		}
 		auto inst = new ASM::MulDivRemInst{};
 		inst->op = op2inst_mul.at(node->cmd);
 		inst->rs1 = getReg(node->lhs);
@@ -177,6 +192,137 @@ void InstMake::visitArithmeticStmt(IR::ArithmeticStmt *node) {
 	}
 }
 
+ASM::Reg *InstMake::add_binary(std::string const &op, ASM::Reg *rs1, ASM::Val *rs2, ASM::Reg *rd) {
+	auto inst = new ASM::BinaryInst{};
+	inst->op = op;
+	inst->rs1 = rs1;
+	inst->rs2 = rs2;
+	inst->rd = rd ? rd : regs->registerVirtualReg();
+	add_inst(inst);
+	return inst->rd;
+}
+
+bool InstMake::mul_by_const(ASM::Reg *rd, ASM::Reg *x, int c) {
+	auto shl = [&](int k) { return k ? add_binary("sll", x, regs->get_imm(k)) : x; };
+	if (c == 0) {
+		auto mv = new ASM::MoveInst{};
+		mv->rs = regs->get("zero");
+		mv->rd = rd;
+		add_inst(mv);
+		return true;
+	}
+	// c = 2^a, 2^a + 2^b or 2^a - 2^b, possibly negated
+	auto u = static_cast<uint32_t>(c);
+	bool neg = c < 0 && !std::has_single_bit(u);
+	if (neg) u = -u;
+	uint32_t low = u & -u, high = u - low;
+	auto res = neg ? regs->registerVirtualReg() : rd;
+	if (high == 0) {
+		if (low == 1) {
+			auto mv = new ASM::MoveInst{};
+			mv->rs = x;
+			mv->rd = res;
+			add_inst(mv);
+		}
+		else
+			add_binary("sll", x, regs->get_imm(std::countr_zero(u)), res);
+	}
+	else if (std::has_single_bit(high))
+		add_binary("add", shl(std::countr_zero(high)), shl(std::countr_zero(low)), res);
+	else if (std::has_single_bit(u + low))
+		add_binary("sub", shl(std::countr_zero(u + low)), shl(std::countr_zero(low)), res);
+	else
+		return false;
+	if (neg) add_binary("sub", regs->get("zero"), res, rd);
+	return true;
+}
+
+/// @brief magic number and shift of signed division by `d`, see Hacker's Delight 10-4
+static std::pair<int, int> div_magic(int d) {
+	uint32_t const two31 = 0x80000000u;
+	uint32_t ad = d < 0 ? -static_cast<uint32_t>(d) : d;
+	uint32_t t = two31 + (static_cast<uint32_t>(d) >> 31);
+	uint32_t anc = t - 1 - t % ad;
+	uint32_t q1 = two31 / anc, r1 = two31 - q1 * anc;
+	uint32_t q2 = two31 / ad, r2 = two31 - q2 * ad;
+	int p = 31;
+	uint32_t delta;
+	do {
+		++p;
+		q1 *= 2, r1 *= 2;
+		if (r1 >= anc) ++q1, r1 -= anc;
+		q2 *= 2, r2 *= 2;
+		if (r2 >= ad) ++q2, r2 -= ad;
+		delta = ad - r2;
+	} while (q1 < delta || (q1 == delta && r1 == 0));
+	auto magic = static_cast<int>(q2 + 1);
+	return {d < 0 ? -magic : magic, p - 32};
+}
+
+bool InstMake::div_by_const(ASM::Reg *rd, ASM::Reg *x, int d, bool rem) {
+	if (d == 0 || d == INT_MIN) return false;
+	auto zero = regs->get("zero");
+	uint32_t ad = d < 0 ? -d : d;
+	if (ad == 1) {
+		if (rem || d > 0) {
+			auto mv = new ASM::MoveInst{};
+			mv->rs = rem ? zero : x;
+			mv->rd = rd;
+			add_inst(mv);
+		}
+		else
+			add_binary("sub", zero, x, rd);
+		return true;
+	}
+	if (std::has_single_bit(ad)) {
+		// a negative x is biased by 2^k - 1 so the shift rounds toward zero
+		int k = std::countr_zero(ad);
+		auto sign = k == 1 ? x : add_binary("sra", x, regs->get_imm(31));
+		auto biased = add_binary("add", x, add_binary("srl", sign, regs->get_imm(32 - k)));
+		if (rem) {
+			ASM::Val *mask = regs->get_imm(-static_cast<int>(ad));
+			if (ad > 2048) {
+				auto li = new ASM::LiInst{regs->registerVirtualReg(), regs->get_imm(-static_cast<int>(ad))};
+				add_inst(li);
+				mask = li->rd;
+			}
+			add_binary("sub", x, add_binary("and", biased, mask), rd);
+		}
+		else if (d > 0)
+			add_binary("sra", biased, regs->get_imm(k), rd);
+		else
+			add_binary("sub", zero, add_binary("sra", biased, regs->get_imm(k)), rd);
+		return true;
+	}
+	auto [magic, shift] = div_magic(d);
+	auto li = new ASM::LiInst{regs->registerVirtualReg(), regs->get_imm(magic)};
+	add_inst(li);
+	auto mulh = new ASM::MulDivRemInst{};
+	mulh->op = "mulh";
+	mulh->rs1 = x;
+	mulh->rs2 = li->rd;
+	mulh->rd = regs->registerVirtualReg();
+	add_inst(mulh);
+	auto q = mulh->rd;
+	if (d > 0 && magic < 0) q = add_binary("add", q, x);
+	if (d < 0 && magic > 0) q = add_binary("sub", q, x);
+	if (shift) q = add_binary("sra", q, regs->get_imm(shift));
+	// round toward zero: add one to a negative quotient
+	q = add_binary("add", q, add_binary("srl", q, regs->get_imm(31)), rem ? nullptr : rd);
+	if (rem) {
+		auto dv = new ASM::LiInst{regs->registerVirtualReg(), regs->get_imm(d)};
+		add_inst(dv);
+		auto mul = new ASM::MulDivRemInst{};
+		mul->op = "mul";
+		mul->rs1 = q;
+		mul->rs2 = dv->rd;
+		mul->rd = regs->registerVirtualReg();
+		add_inst(mul);
+		add_binary("sub", x, mul->rd, rd);
+	}
+	return true;
+}
+
 void InstMake::visitIcmpStmt(IR::IcmpStmt *node) {
 	std::set<std::string> const need_swap = {"sle", "sgt"};
 	std::set<std::string> const need_not = {"sle", "sge", "eq"};
@@ -216,28 +362,48 @@ void InstMake::visitIcmpStmt(IR::IcmpStmt *node) {
 	}
 }
 
+void InstMake::visitSelectStmt(IR::SelectStmt *node) {
+	// res = f ^ ((t ^ f) & -cond), without a branch
+	auto mask = add_binary("sub", regs->get("zero"), getReg(node->cond));
+	auto f = getReg(node->falseVal);
+	if (f == regs->get("zero")) {
+		add_binary("and", getReg(node->trueVal), mask, getReg(node->res));
+		return;
+	}
+	auto diff = add_binary("xor", getReg(node->trueVal), f);
+	add_binary("xor", add_binary("and", diff, mask), f, getReg(node->res));
+}
+
 void InstMake::visitGetElementPtrStmt(IR::GetElementPtrStmt *node) {
 	if (node->indices.size() > 2) throw std::runtime_error("InstMake(getElementPtr): <TODO: too many indices>");
 	auto ptr = getReg(node->pointer);
 	auto rd = getReg(node->res);
 	bool firstTime = true;
 	for (auto index: node->indices) {
-		if (auto num = dynamic_cast<IR::LiteralInt *>(index); num && num->value == 0)
+		auto num = dynamic_cast<IR::LiteralInt *>(index);
+		if (num && num->value == 0)
 			continue;
-		auto idx = getReg(index);
-		if (node->typeName != "i1") {
-			auto shl = new ASM::BinaryInst{};
-			shl->op = "sll";
-			shl->rs1 = idx;
-			shl->rs2 = regs->get_imm(2);
-			shl->rd = regs->registerVirtualReg();
-			add_inst(shl);
-			idx = shl->rd;
+		int size = node->typeName == "i1" ? 1 : 4;
+		ASM::Val *offset;
+		if (num && -2048 / size <= num->value && num->value < 2048 / size)
+			offset = regs->get_imm(num->value * size);// field or constant step: a single addi
+		else {
+			auto idx = getReg(index);
+			if (size != 1) {
+				auto shl = new ASM::BinaryInst{};
+				shl->op = "sll";
+				shl->rs1 = idx;
+				shl->rs2 = regs->get_imm(2);
+				shl->rd = regs->registerVirtualReg();
+				add_inst(shl);
+				idx = shl->rd;
+			}
+			offset = idx;
 		}
 		auto add = new ASM::BinaryInst{};
 		add->op = "add";
 		add->rs1 = firstTime ? ptr : rd;
-		add->rs2 = idx;
+		add->rs2 = offset;
 		add->rd = rd;
 		add_inst(add);
 		firstTime = false;
@@ -292,7 +458,8 @@ void InstMake::visitCondBrStmt(IR::CondBrStmt *node) {
 	auto st_true = block_phi_val(trueBlock, currentIRBlock);
 	auto st_false = block_phi_val(falseBlock, currentIRBlock);
 	std::string cmd = "ne";
-	if (!st_true.empty() && st_false.empty()) {
+	// branch away from the next block, so the jump to it falls through
+	if ((!st_true.empty() && st_false.empty()) || (st_true.empty() && st_false.empty() && trueBlock == nextIRBlock)) {
 		cmd = "eq";
 		std::swap(st_true, st_false);
 		std::swap(trueBlock, falseBlock);
@@ -331,6 +498,28 @@ void InstMake::visitRetStmt(IR::RetStmt *node) {
 	add_inst(new ASM::RetInst{currentFunction});
 }
 
+bool InstMake::tail_call(IR::CallStmt *call, IR::Stmt *next) {
+	auto ret = dynamic_cast<IR::RetStmt *>(next);
+	if (!ret || (ret->value && ret->value != call->res) || call->args.size() > 8) return false;
+	// the frame is gone when the callee runs
+	for (auto arg: call->args)
+		if (auto var = dynamic_cast<IR::Var *>(arg); var && ptr2stack.contains(var)) return false;
+	auto tail = new ASM::TailCallInst{currentFunction};
+	tail->funcName = call->func->name;
+	for (size_t i = 0; i < call->args.size(); ++i) {
+		tail->use.insert(regs->get(10 + i));
+		toExpectReg(call->args[i], regs->get(10 + i));
+	}
+	for (auto [x, v]: calleeSaveTo) {
+		auto mv = new ASM::MoveInst{};
+		mv->rs = v;
+		mv->rd = x;
+		add_inst(mv);
+	}
+	add_inst(tail);
+	return true;
+}
+
 void InstMake::visitGlobalStmt(IR::GlobalStmt *node) {
 	auto val = add_global_val(node->var);
 	auto var = new ASM::GlobalVarInst{};
@@ -453,8 +642,10 @@ std::vector<std::pair<IR::Var *, IR::Val *>> InstMake::block_phi_val(IR::BasicBl
 void InstMake::phi2mv(const std::vector<std::pair<IR::Var *, IR::Val *>> &phis) {
 	// a <- b <- c <- d
 	// then a <- b happens first
+	// a cycle a <- b <- a is broken by saving a to a temporary first
 	std::map<IR::Val *, int> deg;
 	std::map<IR::Val *, IR::Val *> from;
+	std::map<IR::Val *, ASM::Reg *> saved;
 	for (auto [var, val]: phis) {
 		if (var != val)
 			deg[val]++;
@@ -464,19 +655,40 @@ void InstMake::phi2mv(const std::vector<std::pair<IR::Var *, IR::Val *>> &phis)
 	for (auto [var, val]: phis)
 		if (deg[var] == 0)
 			q.push(var);
-	int dealed = 0;
+	size_t dealed = 0;
 	while (dealed < phis.size()) {
 		while (!q.empty()) {
 			auto var = q.front();
 			q.pop();
 			auto val = from[var];
 
-			if (var != val)
-				toExpectReg(val, getReg(var));
+			if (var != val) {
+				if (auto p = saved.find(val); p != saved.end()) {
+					auto mv = new ASM::MoveInst{};
+					mv->rs = p->second;
+					mv->rd = getReg(var);
+					add_inst(mv);
+				}
+				else
+					toExpectReg(val, getReg(var));
+			}
 			++dealed;
 
 			if (var != val && --deg[val] == 0 && from.contains(val))
 				q.push(val);
 		}
+		if (dealed == phis.size()) break;
+		// every var left is waiting inside a cycle
+		for (auto [var, val]: phis)
+			if (deg[var] > 0) {
+				auto mv = new ASM::MoveInst{};
+				mv->rs = getReg(var);
+				mv->rd = regs->registerVirtualReg();
+				add_inst(mv);
+				saved[var] = mv->rd;
+				deg[var] = 0;
+				q.push(var);
+				break;
+			}
 	}
 }
@@ -20,6 +20,7 @@ private:
 	void visitLoadStmt(IR::LoadStmt *node) override;
 	void visitArithmeticStmt(IR::ArithmeticStmt *node) override;
 	void visitIcmpStmt(IR::IcmpStmt *node) override;
+	void visitSelectStmt(IR::SelectStmt *node) override;
 	void visitGetElementPtrStmt(IR::GetElementPtrStmt *node) override;
 	void visitCallStmt(IR::CallStmt *node) override;
 
@@ -39,6 +40,7 @@ private:
 	ASM::Function *currentFunction = nullptr;
 	ASM::Block *currentBlock = nullptr;
 	IR::BasicBlock *currentIRBlock = nullptr;
+	IR::BasicBlock *nextIRBlock = nullptr;// laid out right after currentIRBlock
 	std::map<IR::BasicBlock *, ASM::Block *> block2block;
 	std::map<IR::Val *, ASM::Reg *> val2reg;
 	std::map<IR::Var *, ASM::StackVal *> ptr2stack;
@@ -59,5 +61,14 @@ private:
 	ASM::GlobalVal *add_global_val(IR::Var *ir_var);
 	static std::vector<std::pair<IR::Var *, IR::Val *>> block_phi_val(IR::BasicBlock *dst, IR::BasicBlock *src);
 
+	/// @brief emit `rd = rs1 op rs2`, into a fresh register if `rd` is null
+	ASM::Reg *add_binary(std::string const &op, ASM::Reg *rs1, ASM::Val *rs2, ASM::Reg *rd = nullptr);
+	/// @brief lower `rd = x * c` to shifts and adds, `rd = x / d` and `x % d` to shifts or a mulh by a magic number
+	/// @return false if the M-extension instruction should be kept
+	bool mul_by_const(ASM::Reg *rd, ASM::Reg *x, int c);
+	bool div_by_const(ASM::Reg *rd, ASM::Reg *x, int d, bool rem);
+
 	void phi2mv(const std::vector<std::pair<IR::Var *, IR::Val *>> &phis);
+	/// @return whether `call` followed by `next` was emitted as a tail call
+	bool tail_call(IR::CallStmt *call, IR::Stmt *next);
 };
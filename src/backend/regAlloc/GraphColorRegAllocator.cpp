@@ -2,7 +2,10 @@
 #include "ASM/Node.h"
 #include "ASM/RewriteLayer.h"
 #include "backend/regAlloc/LiveAnalyzer.h"
+#include "backend/regAlloc/LoopAnalyzer.h"
 #include "utils/Graph.h"
+#include <cmath>
+#include <limits>
 #include <ranges>
 #include <stack>
 
@@ -157,6 +160,12 @@ class Allocator {
 	std::map<Reg *, PhysicalReg *> color;
 
 	RegSet spilledNodes;
+	/// @brief uses and defs weighted by loop depth
+	std::map<Reg *, double> spillCost;
+
+	/// @attention 以下成员在整个分配过程中保留
+
+	RegSet spilledBefore;// 已经存栈过的, 只剩很短的活跃区间
 
 public:
 	Allocator(ValueAllocator *regs, Function *func) : regs(regs), func(func) {
@@ -169,6 +178,7 @@ private:
 	void clear();
 	void init();
 	void liveAnalyze();
+	void calcSpillCost();
 	void buildGraph();
 	//	int deg(Reg *reg) { return graph[reg].size(); }
 
@@ -214,6 +224,7 @@ void Allocator::work() {
 		clear();
 		init();
 		liveAnalyze();
+		calcSpillCost();
 		buildGraph();
 		makeWorkList();
 
@@ -256,6 +267,7 @@ void Allocator::clear() {
 	alias.clear();
 	color.clear();
 	spilledNodes.clear();
+	spillCost.clear();
 }
 
 void Allocator::init() {
@@ -291,10 +303,26 @@ void Allocator::liveAnalyze() {
 	liveOut.swap(analyzer.liveOut);
 }
 
+void Allocator::calcSpillCost() {
+	LoopAnalyzer loops(func);
+	loops.work();
+	for (auto block: func->blocks) {
+		double weight = std::pow(10.0, std::min(loops.depth[block], 8));
+		for (auto inst: block->stmts) {
+			for (auto reg: inst->getDef())
+				spillCost[reg] += weight;
+			for (auto reg: inst->getUse())
+				spillCost[reg] += weight;
+		}
+	}
+}
+
 void Allocator::buildGraph() {
 	for (auto block: func->blocks) {
 		auto live = liveOut[block];
 		for (auto inst: std::ranges::reverse_view(block->stmts)) {
+			if (auto br = dynamic_cast<BranchInst *>(inst))
+				live.insert(liveIn[br->dst].begin(), liveIn[br->dst].end());
 			if (auto mv = dynamic_cast<MoveInst *>(inst))
 				live.erase(mv->rs);
 
@@ -431,6 +459,7 @@ void Allocator::coalesce() {
 
 	// merge rs to rd
 	alias[rs] = rd;
+	spillCost[rd] += spillCost[rs];
 	// merge mv s
 	moveList[rd].merge(moveList[rs]);
 	// merge edges
@@ -497,10 +526,14 @@ void Allocator::tryAddToSimplify(Reg *reg) {
 }
 
 void Allocator::selectSpill() {
+	// cheapest per conflict removed, so values used inside loops stay in registers
 	Reg *reg = nullptr;
-	for (auto r: spillWorkList)
-		if (!reg || graph.deg(r) > graph.deg(reg))
-			reg = r;
+	double best = 0;
+	for (auto r: spillWorkList) {
+		double cost = spilledBefore.contains(r) ? std::numeric_limits<double>::infinity() : spillCost[r] / graph.deg(r);
+		if (!reg || cost < best || (cost == best && graph.deg(r) > graph.deg(reg)))
+			reg = r, best = cost;
+	}
 	spillWorkList.erase(reg);
 	freezeMoves(reg);
 	simplifyWorkList.insert(reg);
@@ -538,6 +571,7 @@ void Allocator::rewriteProgram() {
 		auto st = new StackVal{};
 		func->stack.push_back(st);
 		reg2st[reg] = st;
+		spilledBefore.insert(reg);
 	}
 	PutStack(func, reg2st, alias, regs).work();
 }
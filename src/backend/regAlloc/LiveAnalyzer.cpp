@@ -1,5 +1,6 @@
 #include "LiveAnalyzer.h"
 #include <queue>
+#include <ranges>
 
 namespace ASM {
 
@@ -45,26 +46,28 @@ void ASM::LiveAnalyzer::work() {
 	std::queue<Block *> q;
 	std::set<Block *> inQ;
 	std::set<Block *> visited;
-	for (auto block: func->blocks) {
-		auto bak = block->stmts.back();
-		if (dynamic_cast<ASM::RetInst *>(bak)) {
-			q.push(block);
-			inQ.insert(block);
-		}
+	// start from every block, so that blocks never reaching a `ret` are analyzed as well
+	for (auto block: std::ranges::reverse_view(func->blocks)) {
+		q.push(block);
+		inQ.insert(block);
 	}
 	while (!q.empty()) {
 		Block *block = q.front();
 		q.pop();
 		inQ.erase(block);
-		auto UseOld = this->use[block];
-		auto DefOld = this->def[block];
 		std::set<Reg *> newLiveIn, newLiveOut;
 		for (auto succ: successor[block])
 			newLiveOut.insert(liveIn[succ].begin(), liveIn[succ].end());
-		newLiveIn.insert(newLiveOut.begin(), newLiveOut.end());
-		for (auto reg: def[block])
-			newLiveIn.erase(reg);
-		newLiveIn.insert(use[block].begin(), use[block].end());
+		// phi moves of the fall through edge are placed after a branch, they must not kill what the branch target needs
+		newLiveIn = newLiveOut;
+		for (auto inst: std::ranges::reverse_view(block->stmts)) {
+			if (auto br = dynamic_cast<BranchInst *>(inst))
+				newLiveIn.insert(liveIn[br->dst].begin(), liveIn[br->dst].end());
+			for (auto reg: inst->getDef())
+				newLiveIn.erase(reg);
+			for (auto reg: inst->getUse())
+				newLiveIn.insert(reg);
+		}
 		if (!visited.contains(block) || newLiveIn != liveIn[block] || newLiveOut != liveOut[block]) {
 			visited.insert(block);
 			liveIn[block].swap(newLiveIn);
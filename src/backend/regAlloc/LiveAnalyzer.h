@@ -7,6 +7,9 @@
 
 namespace ASM {
 
+/// @brief targets of the branches and jumps in `block`, plus `nextBlock` if it can fall through
+std::vector<Block *> get_successor(Block *block, Block *nextBlock);
+
 class LiveAnalyzer : public ASM::ASMBaseVisitor {
 private:
 	Function *func = nullptr;
@@ -0,0 +1,54 @@
+#include "LoopAnalyzer.h"
+#include "LiveAnalyzer.h"
+#include "utils/Graph.h"
+
+namespace ASM {
+
+void LoopAnalyzer::work() {
+	if (func->blocks.empty()) return;
+	std::map<Block *, std::vector<Block *>> successor;
+	for (auto cur = func->blocks.begin(); cur != func->blocks.end(); ++cur) {
+		auto next = std::next(cur);
+		successor[*cur] = get_successor(*cur, next != func->blocks.end() ? *next : nullptr);
+	}
+
+	std::map<Block *, int> ptr2id;
+	std::vector<Block *> id2ptr{nullptr};
+	std::vector<Block *> stack{func->blocks.front()};
+	ptr2id[func->blocks.front()] = 1, id2ptr.push_back(func->blocks.front());
+	while (!stack.empty()) {
+		auto block = stack.back();
+		stack.pop_back();
+		for (auto to: successor[block])
+			if (!ptr2id.contains(to)) {
+				ptr2id[to] = static_cast<int>(id2ptr.size());
+				id2ptr.push_back(to);
+				stack.push_back(to);
+			}
+	}
+
+	int n = static_cast<int>(id2ptr.size()) - 1;
+	Graph G(n);
+	for (int x = 1; x <= n; ++x)
+		for (auto to: successor[id2ptr[x]])
+			G.add_edge(x, ptr2id[to]);
+	DominateTree dom(G);
+	dom.LengauerTarjan(1);
+	LoopForest forest(G, dom);
+	forest.work(1);
+
+	for (int x = 1; x <= n; ++x) {
+		auto block = id2ptr[x];
+		depth[block] = forest.depth[x];
+		if (forest.header[x])
+			header[block] = id2ptr[forest.header[x]];
+		if (forest.header[x] == x) {
+			if (forest.parent[x])
+				parent[block] = id2ptr[forest.parent[x]];
+			for (auto latch: forest.latches[x])
+				latches[block].push_back(id2ptr[latch]);
+		}
+	}
+}
+
+}// namespace ASM
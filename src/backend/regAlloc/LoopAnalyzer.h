@@ -0,0 +1,25 @@
+#pragma once
+
+#include "ASM/Node.h"
+#include <map>
+#include <vector>
+
+namespace ASM {
+
+/// @brief natural loops over the asm blocks reachable from the function entry
+class LoopAnalyzer {
+private:
+	Function *func = nullptr;
+
+public:
+	std::map<Block *, Block *> header;// innermost loop header of a block, absent if not in a loop
+	std::map<Block *, Block *> parent;// header of the enclosing loop of a header
+	std::map<Block *, std::vector<Block *>> latches;
+	std::map<Block *, int> depth;
+
+public:
+	explicit LoopAnalyzer(Function *func) : func(func) {}
+	void work();
+};
+
+}// namespace ASM
@@ -18,10 +18,31 @@
 #include "backend/regAlloc/GraphColorRegAllocator.h"
 #include "backend/regAlloc/NaiveRegAllocator.h"
 
+#include "opt/IR/ADCE/ADCE.h"
 #include "opt/IR/ConstFold/ConstFold.h"
+#include "opt/IR/DSE/DSE.h"
+#include "opt/IR/GVN/GVN.h"
+#include "opt/IR/GlobalOpt/GlobalOpt.h"
+#include "opt/IR/GlobalPromote/GlobalPromote.h"
+#include "opt/IR/IfConvert/IfConvert.h"
+#include "opt/IR/IndVars/IndVars.h"
+#include "opt/IR/Inliner/Inliner.h"
+#include "opt/IR/InstCombine/InstCombine.h"
+#include "opt/IR/JumpThreading/JumpThreading.h"
+#include "opt/IR/LICM/LICM.h"
+#include "opt/IR/LoadElim/LoadElim.h"
+#include "opt/IR/LoopRotate/LoopRotate.h"
+#include "opt/IR/LoopUnroll/LoopUnroll.h"
+#include "opt/IR/LoopUnswitch/LoopUnswitch.h"
 #include "opt/IR/Mem2Reg/Mem2Reg.h"
+#include "opt/IR/PRE/PRE.h"
+#include "opt/IR/SCCP/SCCP.h"
+#include "opt/IR/Sink/Sink.h"
+#include "opt/IR/TailRecursion/TailRecursion.h"
 #include "opt/IR/UnusedFunctionRemover.h"
+#include "opt/IR/VRP/VRP.h"
 
+#include <cctype>
 #include <fstream>
 #include <iostream>
 
@@ -31,8 +52,11 @@ void SemanticCheck(AST &ast, GlobalScope &globalScope);
 int main(int argc, char *argv[]) {
 	std::set<std::string> config;
 	std::vector<std::string> files;
+	int optLevel = 2;
 	for (auto i = 1; i < argc; ++i) {
-		if (argv[i][0] == '-')
+		if (argv[i][0] == '-' && argv[i][1] == 'O' && std::isdigit(argv[i][2]))
+			optLevel = std::atoi(argv[i] + 2);
+		else if (argv[i][0] == '-')
 			config.insert(argv[i]);
 		else
 			files.emplace_back(argv[i]);
@@ -61,6 +85,69 @@ int main(int argc, char *argv[]) {
 		if (!config.contains("-no-mem2reg"))
 			IR::Mem2Reg(irEnvironment).work();
 
+		if (!config.contains("-no-global-opt"))
+			IR::GlobalOpt(irEnvironment).work();
+
+		if (!config.contains("-no-jump-threading"))
+			IR::JumpThreading(irEnvironment).work();
+
+		if (!config.contains("-no-inline"))
+			IR::Inliner(irEnvironment, optLevel).work();
+
+		if (!config.contains("-no-tail-rec"))
+			IR::TailRecursion(irEnvironment).work();
+
+		if (!config.contains("-no-global-promote"))
+			IR::GlobalPromote(irEnvironment).work();
+
+		if (!config.contains("-no-instcombine"))
+			IR::InstCombine(irEnvironment).work();
+
+		if (!config.contains("-no-sccp"))
+			IR::SCCP(irEnvironment).work();
+
+		if (!config.contains("-no-gvn"))
+			IR::GVN(irEnvironment).work();
+
+		if (!config.contains("-no-load-elim"))
+			IR::LoadElim(irEnvironment).work();
+
+		if (!config.contains("-no-dse"))
+			IR::DSE(irEnvironment).work();
+
+		if (!config.contains("-no-vrp"))
+			IR::VRP(irEnvironment).work();
+
+		if (!config.contains("-no-licm"))
+			IR::LICM(irEnvironment).work();
+
+		if (!config.contains("-no-unswitch"))
+			IR::LoopUnswitch(irEnvironment).work();
+
+		if (!config.contains("-no-unroll"))
+			IR::LoopUnroll(irEnvironment, optLevel).work();
+
+		if (!config.contains("-no-indvars"))
+			IR::IndVars(irEnvironment).work();
+
+		if (!config.contains("-no-rotate"))
+			IR::LoopRotate(irEnvironment).work();
+
+		if (!config.contains("-no-pre"))
+			IR::PRE(irEnvironment).work();
+
+		if (!config.contains("-no-sink"))
+			IR::Sink(irEnvironment).work();
+
+		if (!config.contains("-no-if-convert"))
+			IR::IfConvert(irEnvironment).work();
+
+		if (!config.contains("-no-instcombine"))
+			IR::InstCombine(irEnvironment).work();
+
+		if (!config.contains("-no-adce"))
+			IR::ADCE(irEnvironment).work();
+
 		if (!config.contains("-no-const-fold"))
 			IR::ConstFold(irEnvironment).work();
 
@@ -569,9 +569,7 @@ void IRBuilder::visitWhileStmtNode(AstWhileStmtNode *node) {
 
 	// visit cond
 	add_block(cond);
-	visit(node->cond);
-	auto brBody = env.createCondBrStmt(remove_variable_pointer(exprResult[node->cond]), body, afterLoop);
-	add_stmt(brBody);
+	branch_on(node->cond, body, afterLoop);
 
 	// visit body
 	add_block(body);
@@ -606,9 +604,7 @@ void IRBuilder::visitForStmtNode(AstForStmtNode *node) {
 	// visit cond
 	if (node->cond) {
 		add_block(cond);
-		visit(node->cond);
-		auto br2body = env.createCondBrStmt(remove_variable_pointer(exprResult[node->cond]), body, afterLoop);
-		add_stmt(br2body);
+		branch_on(node->cond, body, afterLoop);
 	}
 	// visit body
 	add_block(body);
@@ -661,11 +657,7 @@ void IRBuilder::visitIfStmtNode(AstIfStmtNode *node) {
 		auto true_block = env.createBasicBlock("if_true_" + std::to_string(ifCounter));
 		auto false_block = (&clause != &node->ifStmts.back() || node->elseStmt) ? env.createBasicBlock("if_false_" + std::to_string(ifCounter)) : nullptr;
 
-		visit(clause.first);
-		auto br_cond = env.createCondBrStmt(remove_variable_pointer(exprResult[clause.first]),
-											true_block,
-											false_block ? false_block : after);
-		add_stmt(br_cond);
+		branch_on(clause.first, true_block, false_block ? false_block : after);
 
 		add_block(true_block);
 		visit(clause.second);
@@ -681,6 +673,33 @@ void IRBuilder::visitIfStmtNode(AstIfStmtNode *node) {
 	add_block(after);
 }
 
+void IRBuilder::branch_on(AstExprNode *cond, IR::BasicBlock *trueBlock, IR::BasicBlock *falseBlock) {
+	if (auto bin = dynamic_cast<AstBinaryExprNode *>(cond); bin && (bin->op == "&&" || bin->op == "||")) {
+		auto calc_right = env.createBasicBlock("short_rhs_" + std::to_string(++andOrCounter));
+		if (bin->op == "&&")
+			branch_on(bin->lhs, calc_right, falseBlock);
+		else
+			branch_on(bin->lhs, trueBlock, calc_right);
+		add_block(calc_right);
+		branch_on(bin->rhs, trueBlock, falseBlock);
+	}
+	else if (auto single = dynamic_cast<AstSingleExprNode *>(cond); single && single->op == "!")
+		branch_on(single->expr, falseBlock, trueBlock);
+	else if (auto ternary = dynamic_cast<AstTernaryExprNode *>(cond)) {
+		++ternaryCounter;
+		auto true_expr = env.createBasicBlock("ternary_true_" + std::to_string(ternaryCounter));
+		auto false_expr = env.createBasicBlock("ternary_false_" + std::to_string(ternaryCounter));
+		branch_on(ternary->cond, true_expr, false_expr);
+		add_block(true_expr);
+		branch_on(ternary->trueExpr, trueBlock, falseBlock);
+		add_block(false_expr);
+		branch_on(ternary->falseExpr, trueBlock, falseBlock);
+	}
+	else {
+		visit(cond);
+		add_stmt(env.createCondBrStmt(remove_variable_pointer(exprResult[cond]), trueBlock, falseBlock));
+	}
+}
 
 void IRBuilder::enterAndOrBinaryExprNode(AstBinaryExprNode *node) {
 	++andOrCounter;
@@ -824,9 +843,7 @@ void IRBuilder::visitTernaryExprNode(AstTernaryExprNode *node) {
 	auto false_expr = env.createBasicBlock("ternary_false_" + std::to_string(ternaryCounter));
 	auto end = env.createBasicBlock("ternary_end_" + std::to_string(ternaryCounter));
 
-	visit(node->cond);
-	auto br_cond = env.createCondBrStmt(remove_variable_pointer(exprResult[node->cond]), true_expr, false_expr);
-	add_stmt(br_cond);
+	branch_on(node->cond, true_expr, false_expr);
 
 	add_block(true_expr);
 	visit(node->trueExpr);
@@ -72,6 +72,8 @@ private:
 	void visitForStmtNode(AstForStmtNode *node) override;
 	void visitWhileStmtNode(AstWhileStmtNode *node) override;
 	void visitIfStmtNode(AstIfStmtNode *node) override;
+	/// @brief jump to `trueBlock` or `falseBlock` on `cond`; `&&`, `||`, `!` and `?:` become branch chains instead of an i1
+	void branch_on(AstExprNode *cond, IR::BasicBlock *trueBlock, IR::BasicBlock *falseBlock);
 
 
 	IR::Val *remove_variable_pointer(IR::Val *val);
@@ -0,0 +1,122 @@
+#include "ADCE.h"
+#include "opt/IR/Analysis/CFG.h"
+#include "opt/IR/Analysis/DomTree.h"
+#include "opt/IR/Analysis/SideEffect.h"
+#include "opt/IR/ConstFold/ConstFold.h"
+#include <map>
+#include <queue>
+#include <set>
+
+using namespace IR;
+
+namespace {
+
+class Sweeper {
+	Wrapper &env;
+	SideEffect const &effect;
+	Function *func;
+	CFG cfg;
+	DomTree pdt;
+	std::map<BasicBlock *, std::vector<BasicBlock *>> controlDeps;
+
+	std::map<Var *, Stmt *> defOf;
+	std::map<Stmt *, BasicBlock *> blockOf;
+	std::set<Stmt *> live;
+	std::queue<Stmt *> q;
+
+public:
+	Sweeper(Wrapper &env, SideEffect const &effect, Function *func)
+		: env(env), effect(effect), func(func), cfg(func), pdt(cfg, true), controlDeps(pdt.frontier(cfg)) {}
+	void work() {
+		collect();
+		propagate();
+		sweep();
+	}
+
+private:
+	void mark(Stmt *stmt) {
+		if (stmt && live.insert(stmt).second)
+			q.push(stmt);
+	}
+	void mark(Val *val) {
+		if (auto var = dynamic_cast<Var *>(val))
+			if (auto p = defOf.find(var); p != defOf.end())
+				mark(p->second);
+	}
+
+	void collect() {
+		std::map<BasicBlock *, int> order;
+		for (auto block: cfg.rpo)
+			order[block] = static_cast<int>(order.size());
+		for (auto block: cfg.rpo) {
+			for (auto [res, phi]: block->phis) {
+				defOf[res] = phi;
+				blockOf[phi] = block;
+			}
+			for (auto stmt: block->stmts) {
+				blockOf[stmt] = block;
+				if (auto def = stmt->getDef())
+					defOf[def] = stmt;
+			}
+		}
+		for (auto block: cfg.rpo) {
+			for (auto stmt: block->stmts)
+				if (effect.has_side_effect(stmt) || dynamic_cast<RetStmt *>(stmt))
+					mark(stmt);
+			// loops are kept even if they compute nothing, they may not terminate
+			for (auto to: cfg.successors[block])
+				if (order[to] <= order[block])
+					mark(block->stmts.back());
+			// no single post dominator to jump to
+			if (dynamic_cast<CondBrStmt *>(block->stmts.back()) && !pdt.idom[block])
+				mark(block->stmts.back());
+		}
+	}
+
+	void propagate() {
+		while (!q.empty()) {
+			auto stmt = q.front();
+			q.pop();
+			auto block = blockOf[stmt];
+			if (auto phi = dynamic_cast<PhiStmt *>(stmt)) {
+				for (auto [from, val]: phi->branches) {
+					mark(val);
+					if (!from->stmts.empty() && blockOf.contains(from->stmts.back()))
+						mark(from->stmts.back());
+				}
+			}
+			else
+				for (auto val: stmt->getUse())
+					mark(val);
+			for (auto dep: controlDeps[block])
+				mark(dep->stmts.back());
+		}
+	}
+
+	void sweep() {
+		for (auto block: cfg.rpo) {
+			std::erase_if(block->phis, [&](auto const &p) { return !live.contains(p.second); });
+			std::list<Stmt *> stmts;
+			for (auto stmt: block->stmts) {
+				if (live.contains(stmt) || dynamic_cast<DirectBrStmt *>(stmt) || dynamic_cast<UnreachableStmt *>(stmt))
+					stmts.push_back(stmt);
+				else if (dynamic_cast<CondBrStmt *>(stmt))
+					// no live stmt depends on the choice, go straight to where both ways meet
+					stmts.push_back(env.createDirectBrStmt(pdt.idom[block]));
+			}
+			block->stmts.swap(stmts);
+		}
+	}
+};
+
+}// namespace
+
+void ADCE::work() {
+	auto module = env.get_module();
+	SideEffect effect(module);
+	for (auto func: module->functions)
+		if (!func->blocks.empty())
+			Sweeper(env, effect, func).work();
+	// blocks skipped by the new jumps are unreachable now
+	ConstFold(env).work();
+}
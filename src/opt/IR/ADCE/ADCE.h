@@ -0,0 +1,18 @@
+#pragma once
+#include "IR/Wrapper.h"
+
+namespace IR {
+
+/// @brief aggressive dead code elimination.
+/// everything is dead until a store, a call with side effects or a `ret` needs it;
+/// branches survive only if a live stmt is control dependent on them (post-dominance frontier).
+class ADCE {
+public:
+	explicit ADCE(Wrapper &env) : env(env) {}
+	void work();
+
+private:
+	Wrapper &env;
+};
+
+}// namespace IR
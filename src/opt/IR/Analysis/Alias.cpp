@@ -0,0 +1,102 @@
+#include "Alias.h"
+#include <queue>
+
+namespace IR {
+
+bool AliasAnalysis::allocates(Function *func) {
+	return func->name == "malloc" || func->name.starts_with("__new");
+}
+
+AliasAnalysis::AliasAnalysis(Function *func, SideEffect const &effect, ModRef const &modRef)
+	: effect(effect), modRef(modRef) {
+	std::map<Var *, std::vector<Stmt *>> users;
+	for (auto block: func->blocks) {
+		for (auto [res, phi]: block->phis)
+			for (auto [pred, val]: phi->branches)
+				if (auto var = dynamic_cast<Var *>(val)) users[var].push_back(phi);
+		for (auto stmt: block->stmts) {
+			if (auto gep = dynamic_cast<GetElementPtrStmt *>(stmt))
+				gepOf[gep->res] = gep;
+			else if (auto call = dynamic_cast<CallStmt *>(stmt); call && call->res && allocates(call->func))
+				fresh.insert(call->res);
+			for (auto val: stmt->getUse())
+				if (auto var = dynamic_cast<Var *>(val)) users[var].push_back(stmt);
+		}
+	}
+
+	// an allocation escapes once it, or a pointer into it, is used other than to be loaded from or stored to
+	for (auto alloc: fresh) {
+		std::queue<Var *> q;
+		q.push(alloc);
+		while (!q.empty() && !escaped.contains(alloc)) {
+			auto var = q.front();
+			q.pop();
+			for (auto user: users[var]) {
+				if (auto gep = dynamic_cast<GetElementPtrStmt *>(user); gep && gep->pointer == var)
+					q.push(gep->res);
+				else if (dynamic_cast<LoadStmt *>(user) || dynamic_cast<IcmpStmt *>(user))
+					continue;
+				else if (auto store = dynamic_cast<StoreStmt *>(user); store && store->value != var)
+					continue;
+				else if (auto call = dynamic_cast<CallStmt *>(user); call && call->func->name.ends_with("array.size"))
+					continue;
+				else
+					escaped.insert(alloc);
+			}
+		}
+	}
+}
+
+AliasAnalysis::Access AliasAnalysis::access_of(Var *pointer) const {
+	if (dynamic_cast<GlobalVar *>(pointer)) return {pointer->name, pointer};
+	auto p = gepOf.find(pointer);
+	if (p == gepOf.end()) return {"", pointer};
+	auto gep = p->second;
+	if (!gep->typeName.starts_with("%class."))
+		return {"[]", gep->pointer, gep->indices.size() == 1 ? gep->indices[0] : nullptr};
+	auto field = gep->indices.size() == 2 ? dynamic_cast<LiteralInt *>(gep->indices[1]) : nullptr;
+	if (!field) return {"", pointer};
+	return {gep->typeName + "." + std::to_string(field->value), gep->pointer};
+}
+
+bool AliasAnalysis::identified(Var *base) const {
+	return dynamic_cast<GlobalVar *>(base) || fresh.contains(base);
+}
+
+bool AliasAnalysis::is_private(Var *pointer) const {
+	auto base = access_of(pointer).base;
+	return fresh.contains(base) && !escaped.contains(base);
+}
+
+AliasAnalysis::Result AliasAnalysis::alias(Var *p, Type *tp, Var *q, Type *tq) const {
+	if (tp->to_string() != tq->to_string()) return NoAlias;
+	if (p == q) return MustAlias;
+	auto a = access_of(p), b = access_of(q);
+	if (!a.where.empty() && !b.where.empty() && a.where != b.where) return NoAlias;
+	if (a.base != b.base) {
+		if (identified(a.base) && identified(b.base)) return NoAlias;
+		if (is_private(p) || is_private(q)) return NoAlias;
+		return MayAlias;
+	}
+	if (a.where.empty() || b.where.empty()) return MayAlias;
+	if (a.where != "[]" || a.index == b.index) return MustAlias;
+	auto i = dynamic_cast<LiteralInt *>(a.index), j = dynamic_cast<LiteralInt *>(b.index);
+	if (!i || !j) return MayAlias;
+	return i->value == j->value ? MustAlias : NoAlias;
+}
+
+bool AliasAnalysis::may_modify(CallStmt *call, Var *pointer) const {
+	// builtins only write memory they allocate
+	if (call->func->blocks.empty() || effect.pure(call->func)) return false;
+	if (auto var = dynamic_cast<GlobalVar *>(pointer)) return modRef.may_write(call->func, var);
+	return !is_private(pointer);
+}
+
+bool AliasAnalysis::may_read(CallStmt *call, Var *pointer) const {
+	// builtins read strings and array sizes, which no stmt ever stores to
+	if (call->func->blocks.empty()) return false;
+	if (auto var = dynamic_cast<GlobalVar *>(pointer)) return modRef.may_read(call->func, var);
+	return !is_private(pointer);
+}
+
+}// namespace IR
@@ -0,0 +1,50 @@
+#pragma once
+#include "ModRef.h"
+#include "SideEffect.h"
+#include <map>
+#include <set>
+
+namespace IR {
+
+/// @brief alias queries between the pointers of a function, relying on Mx being type safe:
+/// memory of one type is only ever accessed as that type, a class field, an array element and a global never share an
+/// address, and memory returned by an allocation is reachable only through that result until it escapes.
+class AliasAnalysis {
+public:
+	AliasAnalysis(Function *func, SideEffect const &effect, ModRef const &modRef);
+
+	enum Result { NoAlias, MayAlias, MustAlias };
+
+	/// @return whether an access of type `tp` through `p` and one of type `tq` through `q` may touch the same memory
+	[[nodiscard]] Result alias(Var *p, Type *tp, Var *q, Type *tq) const;
+	[[nodiscard]] bool may_alias(Var *p, Type *tp, Var *q, Type *tq) const { return alias(p, tp, q, tq) != NoAlias; }
+	/// @return whether `call` may write the memory behind `pointer`
+	[[nodiscard]] bool may_modify(CallStmt *call, Var *pointer) const;
+	/// @return whether `call` may read the memory behind `pointer`
+	[[nodiscard]] bool may_read(CallStmt *call, Var *pointer) const;
+	/// @return whether the memory behind `pointer` is an allocation of this function nobody else can see
+	[[nodiscard]] bool is_private(Var *pointer) const;
+
+	/// @return whether calling `func` returns fresh memory
+	static bool allocates(Function *func);
+
+private:
+	/// @brief `pointer` is `base` (a global, an object or an array) offset to `where` with `index` for arrays
+	struct Access {
+		std::string where;// global name, "%class.A.k", "[]" or empty if unknown
+		Var *base = nullptr;
+		Val *index = nullptr;
+	};
+
+	SideEffect const &effect;
+	ModRef const &modRef;
+	std::map<Var *, GetElementPtrStmt *> gepOf;
+	std::set<Var *> fresh;  // results of allocations
+	std::set<Var *> escaped;// fresh ones stored, passed, returned or merged somewhere
+
+	[[nodiscard]] Access access_of(Var *pointer) const;
+	/// @brief a global or an allocation: two different ones never overlap
+	[[nodiscard]] bool identified(Var *base) const;
+};
+
+}// namespace IR
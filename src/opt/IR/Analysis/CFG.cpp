@@ -0,0 +1,47 @@
+#include "CFG.h"
+#include <algorithm>
+#include <set>
+
+namespace IR {
+
+std::vector<BasicBlock *> successors_of(BasicBlock *block) {
+	if (block->stmts.empty()) return {};
+	auto back = block->stmts.back();
+	if (auto br = dynamic_cast<CondBrStmt *>(back)) {
+		if (br->trueBlock == br->falseBlock)
+			return {br->trueBlock};
+		return {br->trueBlock, br->falseBlock};
+	}
+	if (auto dir = dynamic_cast<DirectBrStmt *>(back))
+		return {dir->block};
+	return {};
+}
+
+CFG::CFG(Function *func) : func(func) {
+	for (auto block: func->blocks) {
+		auto &succ = successors[block];
+		succ = successors_of(block);
+		predecessors[block];
+		for (auto to: succ)
+			predecessors[to].push_back(block);
+	}
+	if (func->blocks.empty()) return;
+	std::set<BasicBlock *> visited;
+	std::vector<std::pair<BasicBlock *, size_t>> stack{{func->blocks.front(), 0}};
+	visited.insert(func->blocks.front());
+	while (!stack.empty()) {
+		auto &[block, index] = stack.back();
+		auto &succ = successors[block];
+		if (index < succ.size()) {
+			auto to = succ[index++];
+			if (visited.insert(to).second)
+				stack.emplace_back(to, 0);
+			continue;
+		}
+		rpo.push_back(block);
+		stack.pop_back();
+	}
+	std::reverse(rpo.begin(), rpo.end());
+}
+
+}// namespace IR
@@ -0,0 +1,19 @@
+#pragma once
+#include "IR/Node.h"
+#include <map>
+#include <vector>
+
+namespace IR {
+
+/// @brief successors of a block, read from its terminator (no duplicates)
+std::vector<BasicBlock *> successors_of(BasicBlock *block);
+
+struct CFG {
+	explicit CFG(Function *func);
+
+	Function *func;
+	std::map<BasicBlock *, std::vector<BasicBlock *>> successors, predecessors;
+	std::vector<BasicBlock *> rpo;// blocks reachable from entry, in reverse post order
+};
+
+}// namespace IR
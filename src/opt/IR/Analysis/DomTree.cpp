@@ -0,0 +1,108 @@
+#include "DomTree.h"
+#include "utils/Graph.h"
+#include <set>
+
+namespace IR {
+
+DomTree::DomTree(CFG &cfg, bool post) : post(post) {
+	auto const &blocks = cfg.rpo;
+	int n = static_cast<int>(blocks.size());
+	std::map<BasicBlock *, int> ptr2id;
+	std::vector<BasicBlock *> id2ptr(n + 2, nullptr);
+	for (int i = 0; i < n; ++i)
+		ptr2id[blocks[i]] = i + 1, id2ptr[i + 1] = blocks[i];
+
+	int root = post ? n + 1 : 1;
+	Graph G(post ? n + 1 : n);
+	for (auto block: blocks)
+		for (auto to: cfg.successors[block]) {
+			if (!ptr2id.contains(to)) continue;
+			if (post)
+				G.add_edge(ptr2id[to], ptr2id[block]);
+			else
+				G.add_edge(ptr2id[block], ptr2id[to]);
+		}
+	if (post) {
+		for (auto block: blocks)
+			if (cfg.successors[block].empty())
+				G.add_edge(root, ptr2id[block]), exits.insert(block);
+		// every block has to be reachable from the virtual exit, connect infinite loops to it
+		while (true) {
+			std::vector<bool> vis(n + 2);
+			std::vector<int> stack{root};
+			vis[root] = true;
+			while (!stack.empty()) {
+				int x = stack.back();
+				stack.pop_back();
+				for (auto y: G[x])
+					if (!vis[y]) vis[y] = true, stack.push_back(y);
+			}
+			int lost = 0;
+			for (int i = n; i >= 1 && !lost; --i)
+				if (!vis[i]) lost = i;// the latest block in rpo is inside the loop
+			if (!lost) break;
+			G.add_edge(root, lost), exits.insert(id2ptr[lost]);
+		}
+	}
+
+	DominateTree dom(G);
+	dom.LengauerTarjan(root);
+	for (int i = 1; i <= n; ++i) {
+		auto block = id2ptr[i];
+		int fa = dom.idom[i];
+		if (i == root || (post && fa == root)) {
+			idom[block] = nullptr;
+			roots.push_back(block);
+			continue;
+		}
+		idom[block] = id2ptr[fa];
+		children[id2ptr[fa]].push_back(block);
+	}
+
+	int clock = 0;
+	std::vector<std::pair<BasicBlock *, bool>> stack;
+	for (auto it = roots.rbegin(); it != roots.rend(); ++it)
+		stack.emplace_back(*it, false);
+	while (!stack.empty()) {
+		auto [block, leave] = stack.back();
+		stack.pop_back();
+		if (leave) {
+			range[block].second = clock;
+			continue;
+		}
+		range[block].first = ++clock;
+		order.push_back(block);
+		stack.emplace_back(block, true);
+		auto &son = children[block];
+		for (auto it = son.rbegin(); it != son.rend(); ++it)
+			stack.emplace_back(*it, false);
+	}
+}
+
+bool DomTree::dominates(BasicBlock *a, BasicBlock *b) const {
+	auto x = range.find(a), y = range.find(b);
+	if (x == range.end() || y == range.end()) return false;
+	return x->second.first <= y->second.first && y->second.second <= x->second.second;
+}
+
+std::map<BasicBlock *, std::vector<BasicBlock *>> DomTree::frontier(CFG &cfg) const {
+	std::map<BasicBlock *, std::vector<BasicBlock *>> ret;
+	for (auto block: order) {
+		auto &from = post ? cfg.successors[block] : cfg.predecessors[block];
+		if (from.size() + exits.contains(block) < 2) continue;
+		auto stop = idom.at(block);
+		for (auto runner: from) {
+			if (!contains(runner)) continue;
+			std::set<BasicBlock *> seen;
+			while (runner && runner != stop && seen.insert(runner).second) {
+				auto &front = ret[runner];
+				if (front.empty() || front.back() != block)
+					front.push_back(block);
+				runner = idom.at(runner);
+			}
+		}
+	}
+	return ret;
+}
+
+}// namespace IR
@@ -0,0 +1,34 @@
+#pragma once
+#include "CFG.h"
+#include <map>
+#include <set>
+#include <vector>
+
+namespace IR {
+
+/// @brief (post-)dominator tree over the blocks reachable from entry.
+/// For post-dominance a virtual exit is the root; blocks that never reach a `ret` (infinite loops)
+/// are attached to it as well. Blocks whose immediate (post-)dominator is the root map to nullptr.
+struct DomTree {
+	explicit DomTree(CFG &cfg, bool post = false);
+
+	bool post;
+	std::map<BasicBlock *, BasicBlock *> idom;
+	std::map<BasicBlock *, std::vector<BasicBlock *>> children;
+	std::vector<BasicBlock *> roots;
+
+	/// @return whether `a` (post-)dominates `b`, reflexive
+	[[nodiscard]] bool dominates(BasicBlock *a, BasicBlock *b) const;
+	[[nodiscard]] bool contains(BasicBlock *block) const { return range.contains(block); }
+	/// @brief blocks in preorder of the tree, parents before children
+	[[nodiscard]] std::vector<BasicBlock *> const &preorder() const { return order; }
+	/// @brief dominance frontier; for a post dominator tree this is the control dependence
+	[[nodiscard]] std::map<BasicBlock *, std::vector<BasicBlock *>> frontier(CFG &cfg) const;
+
+private:
+	std::set<BasicBlock *> exits;// blocks linked to the virtual exit
+	std::map<BasicBlock *, std::pair<int, int>> range;
+	std::vector<BasicBlock *> order;
+};
+
+}// namespace IR
@@ -0,0 +1,36 @@
+#include "Expr.h"
+#include "opt/IR/ConstFold/ConstFold.h"
+
+namespace IR {
+
+std::optional<Expr> expression_of(Stmt *stmt, std::function<Val *(Val *)> const &find) {
+	auto get = [&](Val *val) { return find ? find(val) : val; };
+	if (auto arith = dynamic_cast<ArithmeticStmt *>(stmt)) {
+		std::vector<Val *> ops{get(arith->lhs), get(arith->rhs)};
+		if (is_commutative(arith->cmd) && std::less<Val *>{}(ops[1], ops[0]))
+			std::swap(ops[0], ops[1]);
+		return Expr{arith->cmd, ops};
+	}
+	if (auto icmp = dynamic_cast<IcmpStmt *>(stmt)) {
+		std::string cmd = icmp->cmd;
+		std::vector<Val *> ops{get(icmp->lhs), get(icmp->rhs)};
+		if (cmd == "sgt" || cmd == "sge") {
+			cmd = cmd == "sgt" ? "slt" : "sle";
+			std::swap(ops[0], ops[1]);
+		}
+		else if (is_commutative(cmd) && std::less<Val *>{}(ops[1], ops[0]))
+			std::swap(ops[0], ops[1]);
+		return Expr{"icmp." + cmd, ops};
+	}
+	if (auto select = dynamic_cast<SelectStmt *>(stmt))
+		return Expr{"select", {get(select->cond), get(select->trueVal), get(select->falseVal)}};
+	if (auto gep = dynamic_cast<GetElementPtrStmt *>(stmt)) {
+		std::vector<Val *> ops{get(gep->pointer)};
+		for (auto index: gep->indices)
+			ops.push_back(get(index));
+		return Expr{"gep." + gep->typeName, ops};
+	}
+	return std::nullopt;
+}
+
+}// namespace IR
@@ -0,0 +1,17 @@
+#pragma once
+#include "IR/Node.h"
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace IR {
+
+/// @brief value-number key of a side-effect free stmt (arithmetic, icmp, select, getelementptr).
+/// stmts with equal keys compute the same value: commutative operands are ordered and `a > b` is keyed as `b < a`.
+using Expr = std::pair<std::string, std::vector<Val *>>;
+
+/// @param find maps an operand to its representative, identity if empty
+std::optional<Expr> expression_of(Stmt *stmt, std::function<Val *(Val *)> const &find = {});
+
+}// namespace IR
@@ -0,0 +1,90 @@
+#include "Induction.h"
+#include "opt/IR/ConstFold/ConstFold.h"
+
+namespace IR {
+
+Induction::Induction(CFG &cfg, Loop *loop) : loop(loop) {
+	for (auto block: loop->blocks) {
+		for (auto [res, phi]: block->phis)
+			defOf[res] = phi;
+		for (auto stmt: block->stmts)
+			if (auto def = stmt->getDef())
+				defOf[def] = stmt;
+	}
+	if (!loop->preheader) return;
+	for (auto [res, phi]: loop->header->phis) {
+		if (phi->branches.size() != cfg.predecessors[loop->header].size()) continue;
+		InductionVar iv{phi};
+		bool ok = true;
+		std::optional<int> step;
+		for (auto [from, val]: phi->branches) {
+			if (from == loop->preheader) {
+				iv.start = val;
+				continue;
+			}
+			// phi + c or phi - c
+			auto var = dynamic_cast<Var *>(val);
+			auto arith = var && defOf.contains(var) ? dynamic_cast<ArithmeticStmt *>(defOf[var]) : nullptr;
+			if (!arith || (arith->cmd != "add" && arith->cmd != "sub")) {
+				ok = false;
+				break;
+			}
+			auto lhs = arith->lhs, rhs = arith->rhs;
+			if (arith->cmd == "add" && lhs != res) std::swap(lhs, rhs);
+			auto num = dynamic_cast<LiteralInt *>(rhs);
+			if (lhs != res || !num) {
+				ok = false;
+				break;
+			}
+			int c = arith->cmd == "add" ? num->value : calc_arithmetic("sub", 0, num->value);
+			if (step && *step != c) {
+				ok = false;
+				break;
+			}
+			step = c;
+			iv.increments.push_back(arith);
+		}
+		if (!ok || !step || !iv.start) continue;
+		iv.step = *step;
+		ivOf[res] = &ivs.emplace_back(iv);
+	}
+}
+
+bool Induction::invariant(Val *val) const {
+	auto var = dynamic_cast<Var *>(val);
+	return !var || !defOf.contains(var);
+}
+
+std::optional<Affine> Induction::affine_of(Val *val) const {
+	auto var = dynamic_cast<Var *>(val);
+	if (!var) return std::nullopt;
+	if (auto p = ivOf.find(var); p != ivOf.end())
+		return Affine{p->second};
+	auto p = defOf.find(var);
+	if (p == defOf.end()) return std::nullopt;
+	auto arith = dynamic_cast<ArithmeticStmt *>(p->second);
+	if (!arith) return std::nullopt;
+	auto lhs = arith->lhs, rhs = arith->rhs;
+	if ((arith->cmd == "add" || arith->cmd == "mul") && invariant(lhs)) std::swap(lhs, rhs);
+	if (!invariant(rhs)) return std::nullopt;
+	auto ret = affine_of(lhs);
+	if (!ret) return std::nullopt;
+	auto num = dynamic_cast<LiteralInt *>(rhs);
+	if (arith->cmd == "add" || arith->cmd == "sub") {
+		if (num)
+			ret->constant = calc_arithmetic(arith->cmd, ret->constant, num->value);
+		else if (!ret->offset && arith->cmd == "add")
+			ret->offset = rhs;
+		else
+			return std::nullopt;
+		return ret;
+	}
+	if ((arith->cmd == "mul" || arith->cmd == "shl") && num && !ret->offset) {
+		ret->scale = calc_arithmetic(arith->cmd, ret->scale, num->value);
+		ret->constant = calc_arithmetic(arith->cmd, ret->constant, num->value);
+		return ret;
+	}
+	return std::nullopt;
+}
+
+}// namespace IR
@@ -0,0 +1,39 @@
+#pragma once
+#include "LoopInfo.h"
+#include <list>
+#include <optional>
+
+namespace IR {
+
+/// @brief a basic induction variable: a header phi starting at `start` and growing by `step` on every back edge
+struct InductionVar {
+	PhiStmt *phi = nullptr;
+	Val *start = nullptr;
+	int step = 0;
+	std::vector<ArithmeticStmt *> increments;// phi + step, one for each latch
+};
+
+/// @brief value of `scale * iv + offset + constant` in every iteration, `offset` is loop invariant (nullptr for 0)
+struct Affine {
+	InductionVar *iv = nullptr;
+	int scale = 1;
+	Val *offset = nullptr;
+	int constant = 0;
+};
+
+/// @brief scalar evolution of the values computed in a loop, restricted to affine functions of basic induction variables
+struct Induction {
+	Induction(CFG &cfg, Loop *loop);
+
+	Loop *loop;
+	std::list<InductionVar> ivs;
+
+	[[nodiscard]] bool invariant(Val *val) const;
+	[[nodiscard]] std::optional<Affine> affine_of(Val *val) const;
+
+private:
+	std::map<Var *, Stmt *> defOf;// defs inside the loop
+	std::map<Var *, InductionVar *> ivOf;
+};
+
+}// namespace IR
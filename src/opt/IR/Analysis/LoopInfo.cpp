@@ -0,0 +1,84 @@
+#include "LoopInfo.h"
+#include "utils/Graph.h"
+
+namespace IR {
+
+bool Loop::has_dedicated_exits(CFG &cfg) const {
+	for (auto exit: exits)
+		for (auto pred: cfg.predecessors[exit])
+			if (!contains(pred)) return false;
+	return true;
+}
+
+LoopInfo::LoopInfo(CFG &cfg) {
+	auto const &blocks = cfg.rpo;
+	int n = static_cast<int>(blocks.size());
+	if (n == 0) return;
+	std::map<BasicBlock *, int> ptr2id;
+	std::vector<BasicBlock *> id2ptr(n + 1, nullptr);
+	for (int i = 0; i < n; ++i)
+		ptr2id[blocks[i]] = i + 1, id2ptr[i + 1] = blocks[i];
+	Graph G(n);
+	for (auto block: blocks)
+		for (auto to: cfg.successors[block])
+			if (ptr2id.contains(to))
+				G.add_edge(ptr2id[block], ptr2id[to]);
+	DominateTree dom(G);
+	dom.LengauerTarjan(1);
+	LoopForest forest(G, dom);
+	forest.work(1);
+
+	std::vector<int> headers;
+	for (int x = 1; x <= n; ++x)
+		if (forest.header[x] == x) headers.push_back(x);
+	std::ranges::stable_sort(headers, [&](int a, int b) { return forest.depth[a] < forest.depth[b]; });
+	std::map<int, Loop *> loopOfHeader;
+	for (auto h: headers) {
+		auto &loop = loops.emplace_back();
+		loopOfHeader[h] = &loop;
+		loop.header = id2ptr[h];
+		loop.depth = forest.depth[h];
+		for (auto x: forest.body[h])
+			loop.blocks.insert(id2ptr[x]);
+		for (auto x: forest.latches[h])
+			loop.latches.push_back(id2ptr[x]);
+		if (forest.parent[h]) {
+			loop.parent = loopOfHeader[forest.parent[h]];
+			loop.parent->children.push_back(&loop);
+		}
+		else
+			topLevel.push_back(&loop);
+	}
+	for (int x = 1; x <= n; ++x)
+		if (forest.header[x])
+			loopOf[id2ptr[x]] = loopOfHeader[forest.header[x]];
+
+	for (auto &loop: loops) {
+		std::set<BasicBlock *> seen;
+		for (auto block: blocks) {
+			if (!loop.contains(block)) continue;
+			for (auto to: cfg.successors[block])
+				if (!loop.contains(to) && seen.insert(to).second)
+					loop.exits.push_back(to);
+		}
+		std::vector<BasicBlock *> outside;
+		for (auto pred: cfg.predecessors[loop.header])
+			if (!loop.contains(pred) && ptr2id.contains(pred)) outside.push_back(pred);
+		if (outside.size() == 1 && cfg.successors[outside.front()].size() == 1)
+			loop.preheader = outside.front();
+	}
+}
+
+int LoopInfo::depth(BasicBlock *block) const {
+	auto p = loopOf.find(block);
+	return p == loopOf.end() ? 0 : p->second->depth;
+}
+
+std::vector<Loop *> LoopInfo::inner_to_outer() {
+	std::vector<Loop *> ret;
+	for (auto it = loops.rbegin(); it != loops.rend(); ++it)
+		ret.push_back(&*it);
+	return ret;
+}
+
+}// namespace IR
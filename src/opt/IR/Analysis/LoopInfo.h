@@ -0,0 +1,39 @@
+#pragma once
+#include "CFG.h"
+#include <list>
+#include <map>
+#include <set>
+#include <vector>
+
+namespace IR {
+
+struct Loop {
+	BasicBlock *header = nullptr;
+	Loop *parent = nullptr;
+	std::vector<Loop *> children;
+	std::set<BasicBlock *> blocks;
+	std::vector<BasicBlock *> latches;
+	std::vector<BasicBlock *> exits;// blocks outside the loop with a predecessor inside, in rpo
+	int depth = 0;
+	/// @brief the only predecessor outside the loop, if its single successor is the header
+	BasicBlock *preheader = nullptr;
+
+	[[nodiscard]] bool contains(BasicBlock *block) const { return blocks.contains(block); }
+	/// @brief every exit is entered from inside the loop only
+	[[nodiscard]] bool has_dedicated_exits(CFG &cfg) const;
+};
+
+/// @brief natural loops of the blocks reachable from entry, nested by containment
+struct LoopInfo {
+	explicit LoopInfo(CFG &cfg);
+
+	std::list<Loop> loops;// outer loops come before the loops they contain
+	std::vector<Loop *> topLevel;
+	std::map<BasicBlock *, Loop *> loopOf;// innermost loop of a block
+
+	[[nodiscard]] int depth(BasicBlock *block) const;
+	/// @brief every loop, inner loops before the loops containing them
+	[[nodiscard]] std::vector<Loop *> inner_to_outer();
+};
+
+}// namespace IR
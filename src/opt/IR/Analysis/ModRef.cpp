@@ -0,0 +1,41 @@
+#include "ModRef.h"
+
+namespace IR {
+
+ModRef::ModRef(Module *module) {
+	std::map<Function *, std::set<Function *>> callees;
+	for (auto func: module->functions)
+		for (auto block: func->blocks)
+			for (auto stmt: block->stmts) {
+				if (auto load = dynamic_cast<LoadStmt *>(stmt)) {
+					if (auto var = dynamic_cast<GlobalVar *>(load->pointer)) reads[func].insert(var);
+				}
+				else if (auto store = dynamic_cast<StoreStmt *>(stmt)) {
+					if (auto var = dynamic_cast<GlobalVar *>(store->pointer)) writes[func].insert(var);
+				}
+				else if (auto call = dynamic_cast<CallStmt *>(stmt))
+					callees[func].insert(call->func);
+			}
+	// a caller accesses whatever its callees access, until nothing grows
+	for (bool changed = true; changed;) {
+		changed = false;
+		for (auto &[func, called]: callees)
+			for (auto callee: called) {
+				if (callee == func) continue;
+				for (auto var: reads[callee]) changed |= reads[func].insert(var).second;
+				for (auto var: writes[callee]) changed |= writes[func].insert(var).second;
+			}
+	}
+}
+
+bool ModRef::may_read(Function *func, GlobalVar *var) const {
+	auto p = reads.find(func);
+	return p != reads.end() && p->second.contains(var);
+}
+
+bool ModRef::may_write(Function *func, GlobalVar *var) const {
+	auto p = writes.find(func);
+	return p != writes.end() && p->second.contains(var);
+}
+
+}// namespace IR
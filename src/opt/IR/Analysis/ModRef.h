@@ -0,0 +1,20 @@
+#pragma once
+#include "IR/Node.h"
+#include <map>
+#include <set>
+
+namespace IR {
+
+/// @brief globals each function reads and writes, including through the functions it calls.
+/// Mx can not take the address of a global, so the loads and stores naming it are the only accesses.
+struct ModRef {
+	explicit ModRef(Module *module);
+
+	[[nodiscard]] bool may_read(Function *func, GlobalVar *var) const;
+	[[nodiscard]] bool may_write(Function *func, GlobalVar *var) const;
+
+private:
+	std::map<Function *, std::set<GlobalVar *>> reads, writes;
+};
+
+}// namespace IR
@@ -0,0 +1,306 @@
+#include "Range.h"
+#include "CFG.h"
+#include "DomTree.h"
+#include "opt/IR/ConstFold/ConstFold.h"
+#include <algorithm>
+#include <bit>
+#include <climits>
+#include <set>
+
+namespace IR {
+
+namespace {
+
+Range arithmetic(std::string const &cmd, Range a, Range b) {
+	if (a.empty() || b.empty()) return {};
+	if (cmd == "add") return Range::of(a.lo + b.lo, a.hi + b.hi);
+	if (cmd == "sub") return Range::of(a.lo - b.hi, a.hi - b.lo);
+	if (cmd == "mul") {
+		auto p = {a.lo * b.lo, a.lo * b.hi, a.hi * b.lo, a.hi * b.hi};
+		return Range::of(std::min(p), std::max(p));
+	}
+	if (cmd == "sdiv") {
+		if (b.lo > 0 || b.hi < 0) {
+			auto p = {a.lo / b.lo, a.lo / b.hi, a.hi / b.lo, a.hi / b.hi};
+			return Range::of(std::min(p), std::max(p));
+		}
+		if (a.lo >= 0 && b.lo >= 0) return Range::of(0, a.hi);
+		auto m = std::max(-a.lo, a.hi);
+		return Range::of(-m, m);
+	}
+	if (cmd == "srem") {
+		// the sign follows the dividend and |x % d| <= |x|, also < |d| unless d may be 0
+		auto lo = std::min(a.lo, 0ll), hi = std::max(a.hi, 0ll);
+		if (b.lo > 0 || b.hi < 0) {
+			auto m = std::max(-b.lo, b.hi) - 1;
+			lo = std::max(lo, -m), hi = std::min(hi, m);
+		}
+		return Range::of(a.lo >= 0 ? 0 : lo, a.hi <= 0 ? 0 : hi);
+	}
+	if (cmd == "and") {
+		if (a.lo >= 0 && b.lo >= 0) return Range::of(0, std::min(a.hi, b.hi));
+		if (a.lo >= 0) return Range::of(0, a.hi);
+		if (b.lo >= 0) return Range::of(0, b.hi);
+		return Range::full();
+	}
+	if (cmd == "or" || cmd == "xor") {
+		if (a.lo < 0 || b.lo < 0) return Range::full();
+		auto hi = static_cast<long long>(std::bit_ceil(static_cast<unsigned long long>(std::max(a.hi, b.hi)) + 1)) - 1;
+		return Range::of(cmd == "or" ? std::max(a.lo, b.lo) : 0, hi);
+	}
+	if (cmd == "shl" && b.single() && 0 <= b.lo && b.lo < 32)
+		return Range::of(a.lo * (1ll << b.lo), a.hi * (1ll << b.lo));
+	if (cmd == "ashr" && 0 <= b.lo && b.hi < 32)
+		return Range::of(std::min(a.lo >> b.lo, a.lo >> b.hi), std::max(a.hi >> b.lo, a.hi >> b.hi));
+	return Range::full();
+}
+
+std::optional<bool> compare(std::string cmd, Range a, Range b) {
+	if (cmd == "sgt" || cmd == "sge") {
+		std::swap(a, b);
+		cmd = cmd == "sgt" ? "slt" : "sle";
+	}
+	if (cmd == "slt") {
+		if (a.hi < b.lo) return true;
+		if (a.lo >= b.hi) return false;
+	}
+	if (cmd == "sle") {
+		if (a.hi <= b.lo) return true;
+		if (a.lo > b.hi) return false;
+	}
+	if (cmd == "eq" || cmd == "ne") {
+		bool ne = cmd == "ne";
+		if (a.single() && b.single() && a.lo == b.lo) return !ne;
+		if (a.hi < b.lo || b.hi < a.lo) return ne;
+	}
+	return std::nullopt;
+}
+
+Range compare_range(std::string const &cmd, Range a, Range b) {
+	if (a.empty() || b.empty()) return {};
+	if (auto res = compare(cmd, a, b)) return Range::of(*res, *res);
+	return Range::of(0, 1);
+}
+
+}// namespace
+
+Range Range::full() {
+	return {INT_MIN, INT_MAX};
+}
+
+Range Range::of(long long lo, long long hi) {
+	if (lo < INT_MIN || hi > INT_MAX) return full();
+	return {lo, hi};
+}
+
+Range Range::join(Range const &other) const {
+	if (empty()) return other;
+	if (other.empty()) return *this;
+	return {std::min(lo, other.lo), std::max(hi, other.hi)};
+}
+
+Range Range::meet(Range const &other) const {
+	return {std::max(lo, other.lo), std::min(hi, other.hi)};
+}
+
+RangeAnalysis::RangeAnalysis(Module *module) {
+	init(module);
+	while (sweep(module, false))
+		;
+	for (int i = 0; i < 2; ++i)
+		sweep(module, true);
+}
+
+void RangeAnalysis::init(Module *module) {
+	auto track = [&](Var *var) {
+		if (var && (var->type->to_string() == "i32" || var->type->to_string() == "i1"))
+			value[var];
+	};
+	std::set<Function *> called;
+	for (auto func: module->functions)
+		for (auto block: func->blocks)
+			for (auto stmt: block->stmts) {
+				if (auto var = stmt->getDef()) def[var] = stmt;
+				if (auto call = dynamic_cast<CallStmt *>(stmt)) called.insert(call->func);
+			}
+	for (auto func: module->functions) {
+		if (func->blocks.empty()) continue;
+		// a function nobody calls may get anything
+		if (called.contains(func))
+			for (auto param: func->paramsVar)
+				track(param);
+		returns[func];
+
+		CFG cfg(func);
+		DomTree dom(cfg);
+		rpo[func] = cfg.rpo;
+		for (auto block: dom.preorder()) {
+			auto &known = facts[block];
+			if (auto up = dom.idom.find(block); up != dom.idom.end() && up->second)
+				known = facts[up->second];
+			std::vector<BasicBlock *> preds;
+			std::ranges::copy_if(cfg.predecessors[block], std::back_inserter(preds), [&](BasicBlock *b) { return dom.contains(b); });
+			if (preds.size() == 1)
+				std::ranges::copy(edge_facts(preds.front(), block), std::back_inserter(known));
+		}
+		for (auto block: cfg.rpo) {
+			for (auto [res, phi]: block->phis)
+				track(res);
+			for (auto stmt: block->stmts)
+				track(stmt->getDef());
+		}
+	}
+}
+
+bool RangeAnalysis::sweep(Module *module, bool narrow) {
+	bool changed = false;
+	std::map<Var *, Range> args;
+	std::map<Function *, Range> rets;
+	auto set = [&](Var *var, Range range) {
+		if (auto p = value.find(var); p != value.end())
+			changed |= update(p->second, range, narrow);
+	};
+	for (auto func: module->functions)
+		for (auto block: rpo[func]) {
+			for (auto [res, phi]: block->phis)
+				set(res, eval(phi, block));
+			for (auto stmt: block->stmts) {
+				if (auto var = stmt->getDef())
+					set(var, eval(stmt, block));
+				if (auto call = dynamic_cast<CallStmt *>(stmt); call && !call->func->blocks.empty())
+					for (size_t i = 0; i < call->args.size(); ++i) {
+						auto param = call->func->paramsVar[i];
+						if (!value.contains(param)) continue;
+						auto range = range_of(call->args[i], block);
+						narrow ? void(args[param] = args[param].join(range)) : set(param, range);
+					}
+				if (auto ret = dynamic_cast<RetStmt *>(stmt); ret && ret->value) {
+					auto range = range_of(ret->value, block);
+					narrow ? void(rets[func] = rets[func].join(range)) : void(changed |= update(returns[func], range, false));
+				}
+			}
+		}
+	// parameters and returns are narrowed only once every call site and `ret` has been seen
+	for (auto [param, range]: args)
+		changed |= update(value[param], range, true);
+	for (auto [func, range]: rets)
+		changed |= update(returns[func], range, true);
+	return changed;
+}
+
+bool RangeAnalysis::update(Cell &cell, Range range, bool narrow) {
+	auto old = cell.range;
+	auto now = narrow ? old.meet(range) : old.join(range);
+	if (now == old || (narrow && now.empty())) return false;
+	// widen a bound that keeps moving
+	if (!narrow && ++cell.changes > 3 && !old.empty()) {
+		if (now.lo < old.lo) now.lo = INT_MIN;
+		if (now.hi > old.hi) now.hi = INT_MAX;
+	}
+	cell.range = now;
+	return true;
+}
+
+Range RangeAnalysis::get(Val *val) const {
+	if (auto num = dynamic_cast<LiteralInt *>(val)) return Range::of(num->value, num->value);
+	if (auto cond = dynamic_cast<LiteralBool *>(val)) return Range::of(cond->value, cond->value);
+	if (auto var = dynamic_cast<Var *>(val)) {
+		if (auto p = value.find(var); p != value.end()) return p->second.range;
+		if (var->type->to_string() == "i1") return Range::of(0, 1);
+	}
+	return Range::full();
+}
+
+Range RangeAnalysis::range_of(Val *val, BasicBlock *at) const {
+	auto range = get(val);
+	auto var = dynamic_cast<Var *>(val);
+	if (auto p = facts.find(at); var && p != facts.end())
+		range = apply(range, var, p->second);
+	return range;
+}
+
+Range RangeAnalysis::range_on_edge(Val *val, BasicBlock *from, BasicBlock *to) const {
+	auto range = range_of(val, from);
+	if (auto var = dynamic_cast<Var *>(val))
+		range = apply(range, var, edge_facts(from, to));
+	return range;
+}
+
+std::optional<bool> RangeAnalysis::outcome(IcmpStmt *icmp, BasicBlock *at) const {
+	auto lhs = range_of(icmp->lhs, at), rhs = range_of(icmp->rhs, at);
+	if (lhs.empty() || rhs.empty()) return std::nullopt;
+	return compare(icmp->cmd, lhs, rhs);
+}
+
+Range RangeAnalysis::apply(Range range, Var *var, std::vector<Fact> const &known) const {
+	for (auto &fact: known) {
+		if (fact.var != var) continue;
+		auto other = fact.other ? get(fact.other) : Range::of(fact.value, fact.value);
+		if (other.empty()) continue;
+		if (fact.cmd == "slt") range.hi = std::min(range.hi, other.hi - 1);
+		else if (fact.cmd == "sle")
+			range.hi = std::min(range.hi, other.hi);
+		else if (fact.cmd == "sgt")
+			range.lo = std::max(range.lo, other.lo + 1);
+		else if (fact.cmd == "sge")
+			range.lo = std::max(range.lo, other.lo);
+		else if (fact.cmd == "eq")
+			range = range.meet(other);
+		else if (fact.cmd == "ne" && other.single()) {
+			if (range.lo == other.lo) ++range.lo;
+			if (range.hi == other.lo) --range.hi;
+		}
+	}
+	return range;
+}
+
+std::vector<RangeAnalysis::Fact> RangeAnalysis::edge_facts(BasicBlock *from, BasicBlock *to) const {
+	auto br = dynamic_cast<CondBrStmt *>(from->stmts.back());
+	auto cond = br ? dynamic_cast<Var *>(br->cond) : nullptr;
+	if (!cond || br->trueBlock == br->falseBlock) return {};
+	bool taken = to == br->trueBlock;
+	std::vector<Fact> known{{cond, "eq", nullptr, taken}};
+	auto p = def.find(cond);
+	if (auto icmp = p == def.end() ? nullptr : dynamic_cast<IcmpStmt *>(p->second)) {
+		auto cmd = taken ? icmp->cmd : inverted(icmp->cmd);
+		if (auto lhs = dynamic_cast<Var *>(icmp->lhs)) known.push_back({lhs, cmd, icmp->rhs, 0});
+		if (auto rhs = dynamic_cast<Var *>(icmp->rhs)) known.push_back({rhs, swapped(cmd), icmp->lhs, 0});
+	}
+	return known;
+}
+
+Range RangeAnalysis::eval(Stmt *stmt, BasicBlock *block) const {
+	if (auto arith = dynamic_cast<ArithmeticStmt *>(stmt)) {
+		auto range = arithmetic(arith->cmd, range_of(arith->lhs, block), range_of(arith->rhs, block));
+		return arith->res->type->to_string() == "i1" ? range.meet(Range::of(0, 1)) : range;
+	}
+	if (auto select = dynamic_cast<SelectStmt *>(stmt)) {
+		auto cond = range_of(select->cond, block);
+		if (cond.single()) return range_of(cond.lo ? select->trueVal : select->falseVal, block);
+		return range_of(select->trueVal, block).join(range_of(select->falseVal, block));
+	}
+	if (auto icmp = dynamic_cast<IcmpStmt *>(stmt))
+		return compare_range(icmp->cmd, range_of(icmp->lhs, block), range_of(icmp->rhs, block));
+	if (auto phi = dynamic_cast<PhiStmt *>(stmt)) {
+		Range range;
+		for (auto [from, val]: phi->branches)
+			range = range.join(range_on_edge(val, from, block));
+		return range;
+	}
+	if (auto call = dynamic_cast<CallStmt *>(stmt)) {
+		auto &name = call->func->name;
+		if (name == "__array.size" || name == "_array.size" || name == "string.length") {
+			Range range = Range::of(0, INT_MAX);
+			auto p = call->args.empty() ? def.end() : def.find(dynamic_cast<Var *>(call->args.front()));
+			if (auto made = p == def.end() ? nullptr : dynamic_cast<CallStmt *>(p->second);
+				made && made->func->name.starts_with("__new") && made->func->name.ends_with("Array"))
+				range = range.meet(get(made->args.front()));
+			return range;
+		}
+		if (auto p = returns.find(call->func); p != returns.end()) return p->second.range;
+	}
+	auto var = stmt->getDef();
+	return var && var->type->to_string() == "i1" ? Range::of(0, 1) : Range::full();
+}
+
+}// namespace IR
@@ -0,0 +1,64 @@
+#pragma once
+#include "IR/Node.h"
+#include <map>
+#include <optional>
+#include <vector>
+
+namespace IR {
+
+/// @brief a signed 32-bit interval [lo, hi], empty if lo > hi (not computed yet or never reached)
+struct Range {
+	long long lo = 1, hi = 0;
+
+	static Range full();
+	/// @brief [lo, hi], or the full range if it does not fit in 32 bits (the target wraps)
+	static Range of(long long lo, long long hi);
+
+	[[nodiscard]] bool empty() const { return lo > hi; }
+	[[nodiscard]] bool single() const { return lo == hi; }
+	[[nodiscard]] Range join(Range const &other) const;
+	[[nodiscard]] Range meet(Range const &other) const;
+	bool operator==(Range const &other) const = default;
+};
+
+/// @brief value ranges of the int and bool vars of a module.
+/// a use is refined by the branch conditions dominating it; parameters are the join of the arguments at every call site
+/// and a call is the join of what the callee returns. loops are widened after a few rounds, then narrowed.
+struct RangeAnalysis {
+	explicit RangeAnalysis(Module *module);
+
+	/// @return the range of `val` at `at`
+	[[nodiscard]] Range range_of(Val *val, BasicBlock *at) const;
+	/// @return the outcome of `icmp` if it is evaluated at `at`, if it is known
+	[[nodiscard]] std::optional<bool> outcome(IcmpStmt *icmp, BasicBlock *at) const;
+
+private:
+	/// @brief `var cmd other` holds, `other` is the constant `value` if null
+	struct Fact {
+		Var *var;
+		std::string cmd;
+		Val *other;
+		int value;
+	};
+	struct Cell {
+		Range range;
+		int changes = 0;
+	};
+
+	std::map<Var *, Cell> value;
+	std::map<Function *, Cell> returns;
+	std::map<Var *, Stmt *> def;
+	std::map<BasicBlock *, std::vector<Fact>> facts;// conditions known to hold in a block
+	std::map<Function *, std::vector<BasicBlock *>> rpo;
+
+	void init(Module *module);
+	bool sweep(Module *module, bool narrow);
+	[[nodiscard]] Range get(Val *val) const;
+	[[nodiscard]] Range eval(Stmt *stmt, BasicBlock *block) const;
+	[[nodiscard]] Range apply(Range range, Var *var, std::vector<Fact> const &known) const;
+	[[nodiscard]] std::vector<Fact> edge_facts(BasicBlock *from, BasicBlock *to) const;
+	[[nodiscard]] Range range_on_edge(Val *val, BasicBlock *from, BasicBlock *to) const;
+	static bool update(Cell &cell, Range range, bool narrow);
+};
+
+}// namespace IR
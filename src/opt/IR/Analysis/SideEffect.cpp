@@ -0,0 +1,69 @@
+#include "SideEffect.h"
+#include "CFG.h"
+#include <map>
+
+namespace IR {
+
+namespace {
+bool is_pure_builtin(std::string const &name) {
+	static std::set<std::string> const builtins = {
+			"toString", "_array.size", "__array.size", "malloc", "__newPtrArray", "__newIntArray", "__newBoolArray",
+			"string.length", "string.substring", "string.parseInt", "string.ord", "string.add",
+			"string.equal", "string.notEqual", "string.less", "string.greater", "string.lessEqual", "string.greaterEqual"};
+	return builtins.contains(name);
+}
+
+bool is_acyclic(Function *func) {
+	CFG cfg(func);
+	std::map<BasicBlock *, int> order;
+	for (auto block: cfg.rpo)
+		order[block] = static_cast<int>(order.size());
+	for (auto block: cfg.rpo)
+		for (auto to: cfg.successors[block])
+			if (order[to] <= order[block]) return false;
+	return true;
+}
+}// namespace
+
+SideEffect::SideEffect(Module *module) {
+	std::set<Function *> candidates;
+	for (auto func: module->functions) {
+		if (func->blocks.empty()) {
+			if (is_pure_builtin(func->name))
+				pureFuncs.insert(func);
+			continue;
+		}
+		bool ok = is_acyclic(func);
+		std::set<PtrVar *> allocas;
+		for (auto block: func->blocks)
+			for (auto stmt: block->stmts)
+				if (auto alloca = dynamic_cast<AllocaStmt *>(stmt))
+					allocas.insert(alloca->res);
+		for (auto block: func->blocks)
+			for (auto stmt: block->stmts)
+				if (auto store = dynamic_cast<StoreStmt *>(stmt); store && !allocas.contains(dynamic_cast<PtrVar *>(store->pointer)))
+					ok = false;
+		if (ok) candidates.insert(func);
+	}
+	// grow from the leaves, so recursive functions never get in
+	for (bool changed = true; changed;) {
+		changed = false;
+		for (auto func: candidates) {
+			if (pureFuncs.contains(func)) continue;
+			bool ok = true;
+			for (auto block: func->blocks)
+				for (auto stmt: block->stmts)
+					if (auto call = dynamic_cast<CallStmt *>(stmt); call && !pureFuncs.contains(call->func))
+						ok = false;
+			if (ok) pureFuncs.insert(func), changed = true;
+		}
+	}
+}
+
+bool SideEffect::has_side_effect(Stmt *stmt) const {
+	if (dynamic_cast<StoreStmt *>(stmt)) return true;
+	if (auto call = dynamic_cast<CallStmt *>(stmt)) return !pure(call->func);
+	return false;
+}
+
+}// namespace IR
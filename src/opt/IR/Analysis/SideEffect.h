@@ -0,0 +1,20 @@
+#pragma once
+#include "IR/Node.h"
+#include <set>
+
+namespace IR {
+
+/// @brief functions whose calls can be dropped when the result is unused.
+/// such a function stores only to its own allocas, calls only such functions and always returns (no loop, no recursion).
+struct SideEffect {
+	explicit SideEffect(Module *module);
+
+	[[nodiscard]] bool pure(Function *func) const { return pureFuncs.contains(func); }
+	/// @return whether the stmt writes memory, does I/O or may not terminate
+	[[nodiscard]] bool has_side_effect(Stmt *stmt) const;
+
+private:
+	std::set<Function *> pureFuncs;
+};
+
+}// namespace IR
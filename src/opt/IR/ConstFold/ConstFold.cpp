@@ -32,6 +32,7 @@ private:
 	void cut_edge(BasicBlock *from, BasicBlock *to);
 	Val *find(Val *val);
 	void change(Val *&val, Stmt *at);
+	void change(Var *&var, Stmt *at);
 	void add_queue(Var *var);
 	void check_block(BasicBlock *block);
 	void remove_block(BasicBlock *block);    // // 无入或者无出，直接删除
@@ -45,10 +46,12 @@ private:
 private:
 	void visitArithmeticStmt(IR::ArithmeticStmt *node) override;
 	void visitIcmpStmt(IR::IcmpStmt *node) override;
+	void visitSelectStmt(IR::SelectStmt *node) override;
 	void visitPhiStmt(IR::PhiStmt *node) override;
 	void visitCondBrStmt(IR::CondBrStmt *node) override;
 	void visitRetStmt(IR::RetStmt *node) override;
 	void visitGetElementPtrStmt(IR::GetElementPtrStmt *node) override;
+	void visitLoadStmt(IR::LoadStmt *node) override;
 	void visitCallStmt(IR::CallStmt *node) override;
 	void visitStoreStmt(IR::StoreStmt *node) override;
 };
@@ -303,6 +306,15 @@ void Folder::change(IR::Val *&val, IR::Stmt *at) {
 		usage[var].insert(at);
 }
 
+void Folder::change(IR::Var *&var, IR::Stmt *at) {
+	// a pointer operand takes another variable only
+	auto n = dynamic_cast<Var *>(find(var));
+	if (!n || n == var) return;
+	usage[var].erase(at);
+	var = n;
+	usage[var].insert(at);
+}
+
 static int get_literal(Val *val, bool &ok) {
 	if (!dynamic_cast<Literal *>(val)) {
 		ok = false;
@@ -315,6 +327,76 @@ static int get_literal(Val *val, bool &ok) {
 	return 0;
 }
 
+int IR::calc_arithmetic(std::string const &cmd, int lhs, int rhs) {
+	auto a = static_cast<unsigned>(lhs), b = static_cast<unsigned>(rhs);
+	if (cmd == "add")
+		return static_cast<int>(a + b);
+	if (cmd == "sub")
+		return static_cast<int>(a - b);
+	if (cmd == "mul")
+		return static_cast<int>(a * b);
+	if (cmd == "sdiv") {
+		if (rhs == -1) return static_cast<int>(0u - a);
+		return rhs ? lhs / rhs : 0;
+	}
+	if (cmd == "srem") {
+		if (rhs == -1) return 0;
+		return rhs ? lhs % rhs : 0;
+	}
+	if (cmd == "shl")
+		return static_cast<int>(a << (b & 31));
+	if (cmd == "ashr")
+		return lhs >> (b & 31);
+	if (cmd == "and")
+		return lhs & rhs;
+	if (cmd == "or")
+		return lhs | rhs;
+	if (cmd == "xor")
+		return lhs ^ rhs;
+	throw std::runtime_error("ConstFold: unknown arithmetic cmd " + cmd);
+}
+
+bool IR::calc_icmp(std::string const &cmd, int lhs, int rhs) {
+	if (cmd == "eq")
+		return lhs == rhs;
+	if (cmd == "ne")
+		return lhs != rhs;
+	if (cmd == "slt")
+		return lhs < rhs;
+	if (cmd == "sgt")
+		return lhs > rhs;
+	if (cmd == "sle")
+		return lhs <= rhs;
+	if (cmd == "sge")
+		return lhs >= rhs;
+	throw std::runtime_error("ConstFold: unknown icmp cmd " + cmd);
+}
+
+std::optional<int> IR::literal_of(Val *val) {
+	if (auto num = dynamic_cast<LiteralInt *>(val)) return num->value;
+	if (auto cond = dynamic_cast<LiteralBool *>(val)) return cond->value;
+	if (dynamic_cast<LiteralNull *>(val)) return 0;
+	return std::nullopt;
+}
+
+bool IR::is_commutative(std::string const &cmd) {
+	return cmd == "add" || cmd == "mul" || cmd == "and" || cmd == "or" || cmd == "xor" || cmd == "eq" || cmd == "ne";
+}
+
+std::string IR::swapped(std::string const &cmd) {
+	if (cmd == "slt") return "sgt";
+	if (cmd == "sgt") return "slt";
+	if (cmd == "sle") return "sge";
+	if (cmd == "sge") return "sle";
+	return cmd;
+}
+
+std::string IR::inverted(std::string const &cmd) {
+	static std::map<std::string, std::string> const inv{
+			{"eq", "ne"}, {"ne", "eq"}, {"slt", "sge"}, {"sge", "slt"}, {"sgt", "sle"}, {"sle", "sgt"}};
+	return inv.at(cmd);
+}
+
 void Folder::add_queue(Var *var) {
 	stmtQueue.insert(usage[var].begin(), usage[var].end());
 }
@@ -325,29 +407,7 @@ void Folder::visitArithmeticStmt(IR::ArithmeticStmt *node) {
 	bool ok = true;
 	int lhs = get_literal(node->lhs, ok), rhs = get_literal(node->rhs, ok);
 	if (!ok) return;
-	int res = 0;
-	if (node->cmd == "add")
-		res = lhs + rhs;
-	else if (node->cmd == "sub")
-		res = lhs - rhs;
-	else if (node->cmd == "mul")
-		res = lhs * rhs;
-	else if (node->cmd == "sdiv")
-		res = rhs ? lhs / rhs : 0;
-	else if (node->cmd == "srem")
-		res = rhs ? lhs % rhs : 0;
-	else if (node->cmd == "shl")
-		res = lhs << rhs;
-	else if (node->cmd == "ashr")
-		res = lhs >> rhs;
-	else if (node->cmd == "and")
-		res = lhs & rhs;
-	else if (node->cmd == "or")
-		res = lhs | rhs;
-	else if (node->cmd == "xor")
-		res = lhs ^ rhs;
-	else
-		throw std::runtime_error("ConstFold: unknown arithmetic cmd " + node->cmd);
+	int res = calc_arithmetic(node->cmd, lhs, rhs);
 	if (dynamic_cast<LiteralInt *>(node->lhs))
 		substitute[node->res] = env.get_literal_int(res);
 	else if (dynamic_cast<LiteralBool *>(node->lhs))
@@ -364,26 +424,24 @@ void Folder::visitIcmpStmt(IR::IcmpStmt *node) {
 	bool ok = true;
 	int lhs = get_literal(node->lhs, ok), rhs = get_literal(node->rhs, ok);
 	if (!ok) return;
-	bool res;
-	if (node->cmd == "eq")
-		res = lhs == rhs;
-	else if (node->cmd == "ne")
-		res = lhs != rhs;
-	else if (node->cmd == "slt")
-		res = lhs < rhs;
-	else if (node->cmd == "sgt")
-		res = lhs > rhs;
-	else if (node->cmd == "sle")
-		res = lhs <= rhs;
-	else if (node->cmd == "sge")
-		res = lhs >= rhs;
-	else
-		throw std::runtime_error("ConstFold: unknown icmp cmd " + node->cmd);
+	bool res = calc_icmp(node->cmd, lhs, rhs);
 	substitute[node->res] = env.get_literal_bool(res);
 	add_queue(node->res);
 	removedStmt.insert(node);
 }
 
+void Folder::visitSelectStmt(IR::SelectStmt *node) {
+	change(node->cond, node);
+	change(node->trueVal, node);
+	change(node->falseVal, node);
+	bool ok = true;
+	int cond = get_literal(node->cond, ok);
+	if (!ok && node->trueVal != node->falseVal) return;
+	substitute[node->res] = !ok || cond ? node->trueVal : node->falseVal;
+	add_queue(node->res);
+	removedStmt.insert(node);
+}
+
 void Folder::visitPhiStmt(IR::PhiStmt *node) {
 	for (auto &[block, val]: node->branches)
 		change(val, node);
@@ -418,10 +476,15 @@ void Folder::visitRetStmt(IR::RetStmt *node) {
 }
 
 void Folder::visitGetElementPtrStmt(IR::GetElementPtrStmt *node) {
+	change(node->pointer, node);
 	for (auto &index: node->indices)
 		change(index, node);
 }
 
+void Folder::visitLoadStmt(IR::LoadStmt *node) {
+	change(node->pointer, node);
+}
+
 void Folder::visitCallStmt(IR::CallStmt *node) {
 	for (auto &arg: node->args)
 		change(arg, node);
@@ -429,4 +492,5 @@ void Folder::visitCallStmt(IR::CallStmt *node) {
 
 void Folder::visitStoreStmt(IR::StoreStmt *node) {
 	change(node->value, node);
+	change(node->pointer, node);
 }
@@ -1,9 +1,22 @@
 #pragma once
 #include "IR/RewriteLayer.h"
 #include "IR/Wrapper.h"
+#include <optional>
 
 namespace IR {
 
+/// @brief evaluate an arithmetic/icmp cmd on constants, wrapping like the target does
+int calc_arithmetic(std::string const &cmd, int lhs, int rhs);
+bool calc_icmp(std::string const &cmd, int lhs, int rhs);
+/// @brief the value of an int, bool or null literal
+std::optional<int> literal_of(Val *val);
+/// @brief whether an arithmetic/icmp cmd gives the same result with its operands swapped
+bool is_commutative(std::string const &cmd);
+/// @brief the icmp cmd comparing the swapped operands the same way
+std::string swapped(std::string const &cmd);
+/// @brief the icmp cmd giving the negated result
+std::string inverted(std::string const &cmd);
+
 class ConstFold {
 public:
 	explicit ConstFold(Wrapper &env) : env(env) {}
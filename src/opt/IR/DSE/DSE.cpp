@@ -0,0 +1,133 @@
+#include "DSE.h"
+#include "opt/IR/Analysis/Alias.h"
+#include "opt/IR/Analysis/DomTree.h"
+#include "opt/IR/Analysis/LoopInfo.h"
+#include <algorithm>
+#include <queue>
+#include <set>
+
+using namespace IR;
+
+namespace {
+
+constexpr int maxRegion = 64;// blocks searched between a store and the one overwriting it
+
+class Eliminator {
+	Function *func;
+	AliasAnalysis aa;
+	CFG cfg;
+	DomTree pdt;
+	LoopInfo info;
+	std::map<StoreStmt *, BasicBlock *> blockOf;
+	std::map<Var *, BasicBlock *> defBlock;
+	std::set<Stmt *> removed;
+
+public:
+	Eliminator(Function *func, SideEffect const &effect, ModRef const &modRef)
+		: func(func), aa(func, effect, modRef), cfg(func), pdt(cfg, true), info(cfg) {}
+	void work();
+
+private:
+	[[nodiscard]] bool reads(Stmt *stmt, StoreStmt *store) const;
+	[[nodiscard]] bool never_read(StoreStmt *store) const;
+	[[nodiscard]] bool overwritten(StoreStmt *store) const;
+	/// @return whether every iteration of the loops around `block` left for `at` stores through the same `pointer`
+	[[nodiscard]] bool same_address(Val *pointer, BasicBlock *block, BasicBlock *at) const;
+	/// @return whether `later` is reached on every path from `store` before anything reading it
+	[[nodiscard]] bool overwritten_by(StoreStmt *store, StoreStmt *later) const;
+};
+
+}// namespace
+
+void DSE::work() {
+	SideEffect effect(env.get_module());
+	ModRef modRef(env.get_module());
+	for (auto func: env.get_module()->functions)
+		if (!func->blocks.empty())
+			Eliminator(func, effect, modRef).work();
+}
+
+void Eliminator::work() {
+	for (auto block: func->blocks) {
+		for (auto [res, phi]: block->phis)
+			defBlock[res] = block;
+		for (auto stmt: block->stmts) {
+			if (auto def = stmt->getDef()) defBlock[def] = block;
+			if (auto store = dynamic_cast<StoreStmt *>(stmt)) blockOf[store] = block;
+		}
+	}
+	for (auto [store, block]: blockOf)
+		if (never_read(store) || overwritten(store)) removed.insert(store);
+	for (auto block: func->blocks)
+		std::erase_if(block->stmts, [&](Stmt *stmt) { return removed.contains(stmt); });
+}
+
+bool Eliminator::reads(Stmt *stmt, StoreStmt *store) const {
+	if (auto load = dynamic_cast<LoadStmt *>(stmt))
+		return aa.may_alias(load->pointer, load->res->type, store->pointer, store->value->type);
+	if (auto call = dynamic_cast<CallStmt *>(stmt))
+		return aa.may_read(call, store->pointer);
+	return false;
+}
+
+bool Eliminator::never_read(StoreStmt *store) const {
+	if (!aa.is_private(store->pointer)) return false;
+	return std::ranges::none_of(func->blocks, [&](BasicBlock *block) {
+		return std::ranges::any_of(block->stmts, [&](Stmt *stmt) { return reads(stmt, store); });
+	});
+}
+
+bool Eliminator::overwritten(StoreStmt *store) const {
+	auto block = blockOf.at(store);
+	if (!pdt.contains(block)) return false;
+	// the rest of its own block first
+	auto it = std::next(std::ranges::find(block->stmts, store));
+	for (; it != block->stmts.end(); ++it) {
+		if (reads(*it, store)) return false;
+		auto later = dynamic_cast<StoreStmt *>(*it);
+		if (later && !removed.contains(later) &&
+			aa.alias(later->pointer, later->value->type, store->pointer, store->value->type) == AliasAnalysis::MustAlias)
+			return true;
+	}
+	// a later store in the same block was found above; an earlier one does not run again once a loop is left,
+	// but only the address of its last iteration is overwritten unless the address is the same in every one
+	for (auto [later, at]: blockOf)
+		if (at != block && !removed.contains(later) && pdt.contains(at) && pdt.dominates(at, block) &&
+			aa.alias(later->pointer, later->value->type, store->pointer, store->value->type) == AliasAnalysis::MustAlias &&
+			same_address(store->pointer, block, at) && same_address(later->pointer, block, at) &&
+			overwritten_by(store, later))
+			return true;
+	return false;
+}
+
+bool Eliminator::same_address(Val *pointer, BasicBlock *block, BasicBlock *at) const {
+	auto var = dynamic_cast<Var *>(pointer);
+	auto def = var && defBlock.contains(var) ? defBlock.at(var) : nullptr;
+	if (!def) return true;// globals, parameters and literals
+	auto it = info.loopOf.find(block);
+	for (auto loop = it == info.loopOf.end() ? nullptr : it->second; loop; loop = loop->parent)
+		if (!loop->contains(at) && loop->contains(def)) return false;
+	return true;
+}
+
+bool Eliminator::overwritten_by(StoreStmt *store, StoreStmt *later) const {
+	auto block = blockOf.at(store), target = blockOf.at(later);
+	// every path leaves `block` and runs through these blocks until it enters `target`
+	std::set<BasicBlock *> region;
+	std::queue<BasicBlock *> q;
+	q.push(block);
+	while (!q.empty()) {
+		auto cur = q.front();
+		q.pop();
+		for (auto succ: successors_of(cur))
+			if (succ != target && region.insert(succ).second) q.push(succ);
+		if (static_cast<int>(region.size()) > maxRegion) return false;
+	}
+	for (auto cur: region)
+		if (std::ranges::any_of(cur->stmts, [&](Stmt *stmt) { return reads(stmt, store); })) return false;
+	for (auto stmt: target->stmts) {
+		if (stmt == later) return true;
+		if (reads(stmt, store)) return false;
+	}
+	return false;
+}
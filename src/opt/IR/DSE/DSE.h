@@ -0,0 +1,18 @@
+#pragma once
+#include "IR/Wrapper.h"
+
+namespace IR {
+
+/// @brief dead store elimination.
+/// a store is dead if nothing can read an object that never escapes the function, or if a later store to the same
+/// address is reached on every path before anything that may read it.
+class DSE {
+public:
+	explicit DSE(Wrapper &env) : env(env) {}
+	void work();
+
+private:
+	Wrapper &env;
+};
+
+}// namespace IR
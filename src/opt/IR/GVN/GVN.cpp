@@ -0,0 +1,108 @@
+#include "GVN.h"
+#include "opt/IR/Analysis/DomTree.h"
+#include "opt/IR/Analysis/Expr.h"
+#include <map>
+#include <set>
+
+using namespace IR;
+
+namespace {
+
+class Numbering {
+	Wrapper &env;
+	Function *func;
+
+public:
+	Numbering(Wrapper &wrapper, Function *function) : env(wrapper), func(function) {}
+	void work();
+
+private:
+	std::map<Val *, Val *> substitute;
+	std::set<Stmt *> removed;
+
+	std::map<Expr, Var *> table;
+	std::vector<std::vector<Expr>> scopes;// keys added by each block on the current dominator tree path
+
+	Val *find(Val *val);
+	void number(Expr const &expr, Stmt *stmt);
+};
+
+}// namespace
+
+void GVN::work() {
+	auto module = env.get_module();
+	for (auto function: module->functions)
+		if (!function->blocks.empty())
+			Numbering(env, function).work();
+}
+
+void Numbering::work() {
+	CFG cfg(func);
+	DomTree dom(cfg);
+
+	// walk the dominator tree, an expression is available in the subtree of the block computing it
+	std::vector<std::pair<BasicBlock *, bool>> stack;
+	for (auto root: dom.roots)
+		stack.emplace_back(root, false);
+	while (!stack.empty()) {
+		auto [block, leave] = stack.back();
+		stack.pop_back();
+		if (leave) {
+			for (auto &expr: scopes.back())
+				table.erase(expr);
+			scopes.pop_back();
+			continue;
+		}
+		scopes.emplace_back();
+		stack.emplace_back(block, true);
+
+		// phis of one block with the same incoming values are the same value
+		std::map<std::vector<std::pair<BasicBlock *, Val *>>, Var *> phis;
+		for (auto [res, phi]: block->phis) {
+			std::vector<std::pair<BasicBlock *, Val *>> key;
+			for (auto [from, val]: phi->branches)
+				key.emplace_back(from, find(val));
+			if (auto [it, fresh] = phis.emplace(key, res); !fresh) {
+				substitute[res] = it->second;
+				removed.insert(phi);
+			}
+		}
+		for (auto stmt: block->stmts)
+			if (auto expr = expression_of(stmt, [this](Val *val) { return find(val); }))
+				number(*expr, stmt);
+
+		for (auto son: dom.children[block])
+			stack.emplace_back(son, false);
+	}
+
+	for (auto block: func->blocks) {
+		std::erase_if(block->phis, [&](auto const &p) { return removed.contains(p.second); });
+		std::erase_if(block->stmts, [&](Stmt *stmt) { return removed.contains(stmt); });
+		auto rewrite = [&](Stmt *stmt) {
+			for (auto use: stmt->getUse())
+				if (auto to = find(use); to != use)
+					stmt->replaceUse(use, to);
+		};
+		for (auto [res, phi]: block->phis)
+			rewrite(phi);
+		for (auto stmt: block->stmts)
+			rewrite(stmt);
+	}
+}
+
+Val *Numbering::find(Val *val) {
+	while (substitute.contains(val))
+		val = substitute[val];
+	return val;
+}
+
+void Numbering::number(Expr const &expr, Stmt *stmt) {
+	auto res = stmt->getDef();
+	if (auto it = table.find(expr); it != table.end()) {
+		substitute[res] = it->second;
+		removed.insert(stmt);
+		return;
+	}
+	table.emplace(expr, res);
+	scopes.back().push_back(expr);
+}
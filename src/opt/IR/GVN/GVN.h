@@ -0,0 +1,17 @@
+#pragma once
+#include "IR/Wrapper.h"
+
+namespace IR {
+
+/// @brief dominator based global value numbering.
+/// arithmetic, icmp, getelementptr and phi values that are computed again in a dominated block are replaced.
+class GVN {
+public:
+	explicit GVN(Wrapper &env) : env(env) {}
+	void work();
+
+private:
+	Wrapper &env;
+};
+
+}// namespace IR
@@ -0,0 +1,164 @@
+#include "GlobalOpt.h"
+#include "opt/IR/Analysis/ModRef.h"
+#include "opt/IR/ConstFold/ConstFold.h"
+#include "opt/IR/Mem2Reg/Mem2Reg.h"
+#include <algorithm>
+#include <map>
+#include <set>
+
+using namespace IR;
+
+namespace {
+
+struct Access {
+	Function *func;
+	Stmt *stmt;
+};
+
+class Optimizer {
+	Wrapper &env;
+	Module *module;
+	ModRef modRef;
+
+public:
+	explicit Optimizer(Wrapper &wrapper) : env(wrapper), module(wrapper.get_module()), modRef(module) {}
+	/// @return whether some global became a local
+	bool work();
+
+private:
+	std::map<GlobalVar *, std::vector<Access>> loads, stores;
+	std::map<Function *, std::vector<Access>> calls;// call sites of each function
+	std::map<Val *, Val *> substitute;
+	std::set<Stmt *> removed;
+
+	void collect();
+	[[nodiscard]] bool runs_once(Function *func) const;
+	/// @return the only value `stmt` ever holds, if it is known before the first load
+	[[nodiscard]] Val *constant_of(GlobalStmt *stmt) const;
+	void localize(GlobalStmt *stmt, Function *func);
+	void sweep();
+};
+
+bool is_constant(Val *val) {
+	return dynamic_cast<Literal *>(val) || dynamic_cast<StringLiteralVar *>(val);
+}
+
+}// namespace
+
+void GlobalOpt::work() {
+	if (Optimizer(env).work())
+		Mem2Reg(env).work();
+	else
+		ConstFold(env).work();
+}
+
+bool Optimizer::work() {
+	collect();
+	std::erase_if(module->variables, [&](GlobalStmt *stmt) {
+		auto var = stmt->var;
+		if (auto value = constant_of(stmt)) {
+			for (auto [func, load]: loads[var])
+				substitute[load->getDef()] = value, removed.insert(load);
+			loads.erase(var);
+		}
+		if (loads.contains(var)) return false;
+		for (auto [func, store]: stores[var])
+			removed.insert(store);
+		return true;
+	});
+	sweep();
+
+	collect();
+	bool localized = false;
+	std::erase_if(module->variables, [&](GlobalStmt *stmt) {
+		std::set<Function *> users;
+		for (auto list: {&loads[stmt->var], &stores[stmt->var]})
+			for (auto [func, s]: *list) users.insert(func);
+		if (users.size() != 1 || !runs_once(*users.begin())) return false;
+		localize(stmt, *users.begin());
+		return localized = true;
+	});
+	return localized;
+}
+
+void Optimizer::collect() {
+	loads.clear(), stores.clear(), calls.clear();
+	for (auto func: module->functions)
+		for (auto block: func->blocks)
+			for (auto stmt: block->stmts) {
+				if (auto load = dynamic_cast<LoadStmt *>(stmt)) {
+					if (auto var = dynamic_cast<GlobalVar *>(load->pointer)) loads[var].push_back({func, load});
+				}
+				else if (auto store = dynamic_cast<StoreStmt *>(stmt)) {
+					if (auto var = dynamic_cast<GlobalVar *>(store->pointer)) stores[var].push_back({func, store});
+				}
+				else if (auto call = dynamic_cast<CallStmt *>(stmt))
+					calls[call->func].push_back({func, call});
+			}
+}
+
+bool Optimizer::runs_once(Function *func) const {
+	auto p = calls.find(func);
+	if (func->name == "main") return p == calls.end();
+	// called by `main` before any branch, like the initializer
+	if (p == calls.end() || p->second.size() != 1) return false;
+	auto [caller, call] = p->second.front();
+	auto &entry = caller->blocks.front()->stmts;
+	return caller->name == "main" && !calls.contains(caller) && std::ranges::find(entry, call) != entry.end();
+}
+
+Val *Optimizer::constant_of(GlobalStmt *stmt) const {
+	auto p = stores.find(stmt->var);
+	if (p == stores.end()) return is_constant(stmt->value) ? stmt->value : nullptr;
+	auto value = static_cast<StoreStmt *>(p->second.front().stmt)->value;
+	if (!is_constant(value)) return nullptr;
+	for (auto [func, store]: p->second)
+		if (static_cast<StoreStmt *>(store)->value != value) return nullptr;
+	if (stmt->value == value) return value;
+	// every store is in the initializer, which does not read the global before
+	auto init = p->second.front().func;
+	if (init->name != "init-global-var" || !runs_once(init)) return nullptr;
+	for (auto [func, store]: p->second)
+		if (func != init) return nullptr;
+	auto reads = [&](Stmt *s) {
+		if (auto load = dynamic_cast<LoadStmt *>(s)) return load->pointer == stmt->var;
+		auto call = dynamic_cast<CallStmt *>(s);
+		return call && modRef.may_read(call->func, stmt->var);
+	};
+	for (auto block: init->blocks)
+		if (std::ranges::any_of(block->stmts, reads)) return nullptr;
+	return value;
+}
+
+void Optimizer::localize(GlobalStmt *stmt, Function *func) {
+	auto var = stmt->var;
+	auto slot = env.create_annoy_ptr_var(var->type, "." + var->name + ".");
+	for (auto [f, s]: loads[var])
+		static_cast<LoadStmt *>(s)->pointer = slot;
+	for (auto [f, s]: stores[var])
+		static_cast<StoreStmt *>(s)->pointer = slot;
+	auto &entry = func->blocks.front()->stmts;
+	entry.push_front(env.createStoreStmt(stmt->value, slot));
+	entry.push_front(env.createAllocaStmt(slot));
+}
+
+void Optimizer::sweep() {
+	auto find = [&](Val *val) {
+		while (substitute.contains(val)) val = substitute[val];
+		return val;
+	};
+	auto rewrite = [&](Stmt *stmt) {
+		for (auto use: stmt->getUse())
+			if (auto to = find(use); to != use)
+				stmt->replaceUse(use, to);
+	};
+	for (auto func: module->functions)
+		for (auto block: func->blocks) {
+			std::erase_if(block->stmts, [&](Stmt *stmt) { return removed.contains(stmt); });
+			for (auto [res, phi]: block->phis)
+				rewrite(phi);
+			for (auto stmt: block->stmts)
+				rewrite(stmt);
+		}
+	substitute.clear(), removed.clear();
+}
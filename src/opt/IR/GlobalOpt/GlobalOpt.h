@@ -0,0 +1,19 @@
+#pragma once
+#include "IR/Wrapper.h"
+
+namespace IR {
+
+/// @brief module level optimization of globals.
+/// a global always holding one literal is replaced by it, a global never read is removed with its stores, and a
+/// global only used by a function that runs once (`main`, the initializer) becomes a local of it for Mem2Reg.
+/// runs before inlining, while the initializer is still a function of its own.
+class GlobalOpt {
+public:
+	explicit GlobalOpt(Wrapper &env) : env(env) {}
+	void work();
+
+private:
+	Wrapper &env;
+};
+
+}// namespace IR
@@ -0,0 +1,84 @@
+#include "GlobalPromote.h"
+#include "opt/IR/Analysis/ModRef.h"
+#include "opt/IR/Mem2Reg/Mem2Reg.h"
+#include <map>
+
+using namespace IR;
+
+namespace {
+
+class Promoter {
+	Wrapper &env;
+	ModRef const &modRef;
+	Function *func;
+
+public:
+	Promoter(Wrapper &env, ModRef const &modRef, Function *func) : env(env), modRef(modRef), func(func) {}
+	/// @return whether any global got a copy
+	bool work();
+
+private:
+	void promote(GlobalVar *var, bool written);
+	/// @brief `to = from` through a fresh register
+	std::list<Stmt *>::iterator copy(std::list<Stmt *> &stmts, std::list<Stmt *>::iterator pos, Var *to, Var *from, Type *type) {
+		auto tmp = env.create_annoy_var(type, ".global.");
+		pos = stmts.insert(pos, env.createLoadStmt(tmp, from));
+		return stmts.insert(std::next(pos), env.createStoreStmt(tmp, to));
+	}
+};
+
+}// namespace
+
+void GlobalPromote::work() {
+	ModRef modRef(env.get_module());
+	bool changed = false;
+	for (auto func: env.get_module()->functions)
+		if (!func->blocks.empty())
+			changed |= Promoter(env, modRef, func).work();
+	if (changed) Mem2Reg(env).work();
+}
+
+bool Promoter::work() {
+	std::map<GlobalVar *, int> accesses;
+	std::map<GlobalVar *, bool> written;
+	for (auto block: func->blocks)
+		for (auto stmt: block->stmts) {
+			if (auto load = dynamic_cast<LoadStmt *>(stmt)) {
+				if (auto var = dynamic_cast<GlobalVar *>(load->pointer)) ++accesses[var];
+			}
+			else if (auto store = dynamic_cast<StoreStmt *>(stmt)) {
+				if (auto var = dynamic_cast<GlobalVar *>(store->pointer)) ++accesses[var], written[var] = true;
+			}
+		}
+	bool changed = false;
+	for (auto [var, count]: accesses)
+		if (count > 1) {
+			promote(var, written[var]);
+			changed = true;
+		}
+	return changed;
+}
+
+void Promoter::promote(GlobalVar *var, bool written) {
+	auto slot = env.create_annoy_ptr_var(var->type, "." + var->name + ".");
+	for (auto block: func->blocks)
+		for (auto it = block->stmts.begin(); it != block->stmts.end(); ++it) {
+			if (auto load = dynamic_cast<LoadStmt *>(*it); load && load->pointer == var)
+				load->pointer = slot;
+			else if (auto store = dynamic_cast<StoreStmt *>(*it); store && store->pointer == var)
+				store->pointer = slot;
+			else if (auto call = dynamic_cast<CallStmt *>(*it)) {
+				// memory only lags behind the copy if this function writes the global itself
+				if (written && modRef.may_read(call->func, var))
+					it = std::next(copy(block->stmts, it, var, slot, var->type));
+				if (modRef.may_write(call->func, var))
+					it = copy(block->stmts, std::next(it), slot, var, var->type);
+			}
+			else if (written && dynamic_cast<RetStmt *>(*it))
+				it = std::next(copy(block->stmts, it, var, slot, var->type));
+		}
+
+	auto &entry = func->blocks.front()->stmts;
+	copy(entry, entry.begin(), slot, var, var->type);
+	entry.push_front(env.createAllocaStmt(slot));
+}
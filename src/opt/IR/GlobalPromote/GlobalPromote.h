@@ -0,0 +1,19 @@
+#pragma once
+#include "IR/Wrapper.h"
+
+namespace IR {
+
+/// @brief keep globals in registers inside a function.
+/// a global accessed more than once gets a local copy, loaded on entry; memory is brought up to date only before a
+/// call reading it and before returning, and the copy is reloaded after a call writing it. Mem2Reg then turns the
+/// copies into SSA values.
+class GlobalPromote {
+public:
+	explicit GlobalPromote(Wrapper &env) : env(env) {}
+	void work();
+
+private:
+	Wrapper &env;
+};
+
+}// namespace IR
@@ -0,0 +1,108 @@
+#include "IfConvert.h"
+#include "opt/IR/Analysis/CFG.h"
+#include <algorithm>
+#include <ranges>
+
+using namespace IR;
+
+namespace {
+
+constexpr int maxArmSize = 4;// stmts run for nothing when the other arm is taken
+constexpr int selectCost = 3;// a select is sub, xor, and, xor: four instructions, less the branch it removes
+constexpr int maxCost = 10;
+
+class Converter {
+	Wrapper &env;
+	Function *func;
+
+public:
+	Converter(Wrapper &wrapper, Function *function) : env(wrapper), func(function) {}
+	void work();
+
+private:
+	bool convert(CFG &cfg, BasicBlock *block);
+};
+
+bool speculatable(Stmt *stmt) {
+	if (auto arith = dynamic_cast<ArithmeticStmt *>(stmt)) {
+		if (arith->cmd != "sdiv" && arith->cmd != "srem") return true;
+		auto divisor = dynamic_cast<LiteralInt *>(arith->rhs);
+		return divisor && divisor->value != 0;
+	}
+	return dynamic_cast<IcmpStmt *>(stmt) || dynamic_cast<SelectStmt *>(stmt) || dynamic_cast<GetElementPtrStmt *>(stmt);
+}
+
+}// namespace
+
+void IfConvert::work() {
+	for (auto func: env.get_module()->functions)
+		if (!func->blocks.empty())
+			Converter(env, func).work();
+}
+
+void Converter::work() {
+	bool changed = true;
+	while (changed) {
+		changed = false;
+		CFG cfg(func);
+		// inner diamonds first, so that an outer one may see a converted arm
+		for (auto block: std::views::reverse(cfg.rpo))
+			if (convert(cfg, block)) {
+				changed = true;
+				break;
+			}
+	}
+}
+
+bool Converter::convert(CFG &cfg, BasicBlock *block) {
+	auto br = dynamic_cast<CondBrStmt *>(block->stmts.back());
+	if (!br || br->trueBlock == br->falseBlock || dynamic_cast<Literal *>(br->cond)) return false;
+
+	// an arm is a block entered from `block` only and jumping to the join; or nothing, if `block` jumps to the join
+	auto arm_to = [&](BasicBlock *arm) -> BasicBlock * {
+		auto dir = dynamic_cast<DirectBrStmt *>(arm->stmts.back());
+		if (!dir || !arm->phis.empty() || cfg.predecessors[arm].size() != 1) return nullptr;
+		if (static_cast<int>(arm->stmts.size()) - 1 > maxArmSize) return nullptr;
+		if (!std::all_of(arm->stmts.begin(), std::prev(arm->stmts.end()), speculatable)) return nullptr;
+		return dir->block;
+	};
+	BasicBlock *t = br->trueBlock, *f = br->falseBlock, *join;
+	if (auto to = arm_to(t); to && (to == f || to == arm_to(f)))
+		join = to;
+	else if (auto from = arm_to(f); from == t)
+		join = t;
+	else
+		return false;
+	if (t == join) t = block;
+	if (f == join) f = block;
+	// `block` is the only way into the join afterwards
+	std::vector<BasicBlock *> expect{t, f};
+	auto preds = cfg.predecessors[join];
+	if (preds.size() != 2 || !std::ranges::is_permutation(preds, expect) || join == block) return false;
+
+	int cost = static_cast<int>(join->phis.size()) * selectCost;
+	for (auto arm: {t, f})
+		if (arm != block) cost += static_cast<int>(arm->stmts.size()) - 1;
+	if (cost > maxCost) return false;
+
+	block->stmts.pop_back();
+	for (auto arm: {t, f})
+		if (arm != block) {
+			arm->stmts.pop_back();
+			block->stmts.splice(block->stmts.end(), arm->stmts);
+		}
+	for (auto [res, phi]: join->phis)
+		block->stmts.push_back(env.createSelectStmt(res, br->cond, phi->branches[t], phi->branches[f]));
+	join->phis.clear();
+	// the join is merged into `block`
+	block->stmts.splice(block->stmts.end(), join->stmts);
+	for (auto succ: cfg.successors[join])
+		for (auto [res, phi]: succ->phis)
+			if (auto p = phi->branches.find(join); p != phi->branches.end()) {
+				auto val = p->second;
+				phi->branches.erase(p);
+				phi->branches[block] = val;
+			}
+	std::erase_if(func->blocks, [&](BasicBlock *b) { return b != block && (b == t || b == f || b == join); });
+	return true;
+}
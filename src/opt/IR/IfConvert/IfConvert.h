@@ -0,0 +1,18 @@
+#pragma once
+#include "IR/Wrapper.h"
+
+namespace IR {
+
+/// @brief if-conversion of small diamonds and triangles.
+/// when both arms only compute cheap side-effect free values, they are run unconditionally and the phis joining them
+/// become selects, which the backend lowers without a branch.
+class IfConvert {
+public:
+	explicit IfConvert(Wrapper &env) : env(env) {}
+	void work();
+
+private:
+	Wrapper &env;
+};
+
+}// namespace IR
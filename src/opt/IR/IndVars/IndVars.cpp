@@ -0,0 +1,199 @@
+#include "IndVars.h"
+#include "opt/IR/Analysis/DomTree.h"
+#include "opt/IR/Analysis/Induction.h"
+#include "opt/IR/Analysis/Range.h"
+#include "opt/IR/ConstFold/ConstFold.h"
+#include "opt/IR/LoopSimplify/LoopSimplify.h"
+#include <algorithm>
+#include <set>
+#include <tuple>
+
+using namespace IR;
+
+namespace {
+
+constexpr long long maxSpan = 1 << 28;// iterations whose addresses can not wrap when compared, even for 4-byte elements
+
+/// @brief a pointer `base + (iv + offset + constant) * sizeof(T)` kept in a header phi
+struct Reduced {
+	GetElementPtrStmt *sample;
+	BasicBlock *block;// where `sample` was
+	Affine affine;
+	Var *ptr;
+};
+
+class Reducer {
+	Wrapper &env;
+	RangeAnalysis const &ranges;
+	Function *func;
+	std::map<Val *, std::vector<Stmt *>> users;
+
+public:
+	Reducer(Wrapper &env, RangeAnalysis const &ranges, Function *func) : env(env), ranges(ranges), func(func) {}
+	void work() {
+		LoopSimplify(env).work(func);
+		CFG cfg(func);
+		LoopInfo info(cfg);
+		DomTree dom(cfg);
+		for (auto loop: info.inner_to_outer())
+			if (loop->preheader)
+				run(cfg, dom, loop);
+	}
+
+private:
+	void collect_users() {
+		users.clear();
+		for (auto block: func->blocks) {
+			for (auto [res, phi]: block->phis)
+				for (auto val: phi->getUse())
+					users[val].push_back(phi);
+			for (auto stmt: block->stmts)
+				for (auto val: stmt->getUse())
+					users[val].push_back(stmt);
+		}
+	}
+	[[nodiscard]] bool used_outside(Var *var, Loop *loop, std::map<Stmt *, BasicBlock *> &blockOf) {
+		return std::ranges::any_of(users[var], [&](Stmt *user) { return !loop->contains(blockOf[user]); });
+	}
+
+	Var *new_like(Var *var) {
+		if (auto ptr = dynamic_cast<PtrVar *>(var))
+			return env.create_annoy_ptr_var(ptr->objType, ".iv.ptr.");
+		return env.create_annoy_var(var->type, ".iv.ptr.");
+	}
+	/// @brief compute `a + b` in front of the terminator of `block`
+	Val *add(BasicBlock *block, Val *a, Val *b) {
+		auto x = dynamic_cast<LiteralInt *>(a), y = dynamic_cast<LiteralInt *>(b);
+		if (y && y->value == 0) return a;
+		if (x && x->value == 0) return b;
+		if (x && y) return env.get_literal_int(static_cast<int>(static_cast<unsigned>(x->value) + static_cast<unsigned>(y->value)));
+		auto res = env.create_annoy_var(env.intType, ".iv.idx.");
+		block->stmts.insert(std::prev(block->stmts.end()), env.createArithmeticStmt("add", res, a, b));
+		return res;
+	}
+	Val *index_at(BasicBlock *block, Val *iv, Affine const &affine) {
+		auto idx = add(block, iv, affine.offset ? affine.offset : env.get_literal_int(0));
+		return add(block, idx, env.get_literal_int(affine.constant));
+	}
+
+	void run(CFG &cfg, DomTree &dom, Loop *loop) {
+		Induction ind(cfg, loop);
+		if (ind.ivs.empty()) return;
+		collect_users();
+		std::map<Stmt *, BasicBlock *> blockOf;
+		for (auto block: func->blocks) {
+			for (auto [res, phi]: block->phis) blockOf[phi] = block;
+			for (auto stmt: block->stmts) blockOf[stmt] = block;
+		}
+
+		auto preheader = loop->preheader, header = loop->header;
+		// addresses differing in the constant only share one pointer, e.g. the copies of an unrolled body
+		std::map<std::tuple<std::string, Var *, InductionVar *, Val *>, Reduced> reduced;
+		std::map<Val *, Val *> replace;
+		std::set<Stmt *> removed;
+		for (auto block: cfg.rpo) {
+			if (!loop->contains(block)) continue;
+			for (auto &stmt: block->stmts) {
+				auto gep = dynamic_cast<GetElementPtrStmt *>(stmt);
+				if (!gep || gep->indices.size() != 1 || !ind.invariant(gep->pointer)) continue;
+				auto affine = ind.affine_of(gep->indices[0]);
+				if (!affine || affine->scale != 1 || (affine->offset && !ind.invariant(affine->offset))) continue;
+				if (used_outside(gep->res, loop, blockOf)) continue;
+				auto key = std::make_tuple(gep->typeName, gep->pointer, affine->iv, affine->offset);
+				auto p = reduced.find(key);
+				if (p == reduced.end()) {
+					auto iv = affine->iv;
+					auto first = new_like(gep->res);
+					preheader->stmts.insert(std::prev(preheader->stmts.end()),
+											env.createGetElementPtrStmt(gep->typeName, first, gep->pointer, std::vector<Val *>{index_at(preheader, iv->start, *affine)}));
+					auto ptr = new_like(gep->res);
+					auto phi = env.createPhiStmt(ptr);
+					phi->branches[preheader] = first;
+					for (auto [from, val]: iv->phi->branches) {
+						if (from == preheader) continue;
+						auto next = new_like(gep->res);
+						from->stmts.insert(std::prev(from->stmts.end()),
+										   env.createGetElementPtrStmt(gep->typeName, next, ptr, std::vector<Val *>{env.get_literal_int(iv->step)}));
+						phi->branches[from] = next;
+					}
+					header->phis[ptr] = phi;
+					p = reduced.emplace(key, Reduced{gep, block, *affine, ptr}).first;
+				}
+				if (int diff = calc_arithmetic("sub", affine->constant, p->second.affine.constant); diff != 0) {
+					stmt = env.createGetElementPtrStmt(gep->typeName, gep->res, p->second.ptr, std::vector<Val *>{env.get_literal_int(diff)});
+					continue;
+				}
+				replace[gep->res] = p->second.ptr;
+				removed.insert(gep);
+			}
+		}
+		if (removed.empty()) return;
+		for (auto block: func->blocks) {
+			std::erase_if(block->stmts, [&](Stmt *stmt) { return removed.contains(stmt); });
+			for (auto [res, phi]: block->phis)
+				for (auto [from, to]: replace) phi->replaceUse(from, to);
+			for (auto stmt: block->stmts)
+				for (auto val: stmt->getUse())
+					if (auto p = replace.find(val); p != replace.end())
+						stmt->replaceUse(val, p->second);
+		}
+		collect_users();
+		replace_test(dom, loop, ind, reduced);
+	}
+
+	/// @brief `icmp iv, n` in the header becomes `icmp ptr, base + n`, if the test is all `iv` is needed for.
+	/// `base + n` must not wrap: the test is the only way out, so every address up to it is loaded on the way unless
+	/// the loop does not run, and `n - start` is small enough for an empty loop too.
+	template<typename Map>
+	void replace_test(DomTree &dom, Loop *loop, Induction &ind, Map const &reduced) {
+		auto header = loop->header;
+		if (!std::ranges::all_of(loop->blocks, [&](BasicBlock *block) {
+				return block == header || std::ranges::all_of(successors_of(block), [&](auto to) { return loop->contains(to); });
+			}))
+			return;
+		auto br = dynamic_cast<CondBrStmt *>(loop->header->stmts.back());
+		auto cond = br ? dynamic_cast<Var *>(br->cond) : nullptr;
+		if (!cond) return;
+		IcmpStmt *icmp = nullptr;
+		for (auto stmt: loop->header->stmts)
+			if (stmt->getDef() == cond) icmp = dynamic_cast<IcmpStmt *>(stmt);
+		if (!icmp) return;
+		for (auto &iv: ind.ivs) {
+			auto res = iv.phi->res;
+			bool lhs = icmp->lhs == res;
+			auto bound = lhs ? icmp->rhs : icmp->lhs;
+			if ((!lhs && icmp->rhs != res) || !ind.invariant(bound)) continue;
+			// the increments feed the phi only, the phi feeds them and the test only
+			auto only = [&](Val *val, auto const &allowed) {
+				return std::ranges::all_of(users[val], [&](Stmt *user) { return allowed(user); });
+			};
+			bool dead = only(res, [&](Stmt *user) { return user == icmp || std::ranges::find(iv.increments, user) != iv.increments.end(); });
+			for (auto inc: iv.increments)
+				dead = dead && only(inc->res, [&](Stmt *user) { return user == iv.phi; });
+			if (!dead) continue;
+			auto preheader = loop->preheader;
+			auto b = ranges.range_of(bound, preheader), s = ranges.range_of(iv.start, preheader);
+			if (b.empty() || s.empty() || b.lo - s.hi < -maxSpan || b.hi - s.lo > maxSpan) continue;
+			for (auto &[key, r]: reduced) {
+				if (r.affine.iv != &iv) continue;
+				if (!std::ranges::all_of(loop->latches, [&](BasicBlock *latch) { return dom.dominates(r.block, latch); }))
+					continue;
+				auto end = new_like(r.ptr);
+				preheader->stmts.insert(std::prev(preheader->stmts.end()),
+										env.createGetElementPtrStmt(r.sample->typeName, end, r.sample->pointer, std::vector<Val *>{index_at(preheader, bound, r.affine)}));
+				(lhs ? icmp->lhs : icmp->rhs) = r.ptr;
+				(lhs ? icmp->rhs : icmp->lhs) = end;
+				return;
+			}
+		}
+	}
+};
+
+}// namespace
+
+void IndVars::work() {
+	RangeAnalysis ranges(env.get_module());
+	for (auto func: env.get_module()->functions)
+		if (!func->blocks.empty())
+			Reducer(env, ranges, func).work();
+}
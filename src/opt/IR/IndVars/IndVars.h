@@ -0,0 +1,18 @@
+#pragma once
+#include "IR/Wrapper.h"
+
+namespace IR {
+
+/// @brief induction variable strength reduction and linear function test replacement.
+/// `getelementptr T, base, i + c` in a loop becomes a pointer advanced on every back edge,
+/// and an exit test on `i` is rewritten to compare that pointer when it can not wrap, so `i` itself can die.
+class IndVars {
+public:
+	explicit IndVars(Wrapper &env) : env(env) {}
+	void work();
+
+private:
+	Wrapper &env;
+};
+
+}// namespace IR
@@ -0,0 +1,202 @@
+#include "Inliner.h"
+#include "IR/Cloner.h"
+#include "opt/IR/Analysis/CFG.h"
+#include <algorithm>
+#include <set>
+
+using namespace IR;
+
+namespace {
+
+constexpr int alwaysInlineSize = 8;// a callee this small costs no more than the call
+constexpr int maxCallerSize = 4000;
+
+/// @brief the largest callee size, less the cost of the call, inlined
+int threshold_of(int level) {
+	if (level <= 0) return -1;
+	if (level == 1) return 24;
+	if (level == 2) return 48;
+	return 96;
+}
+
+int size_of(Function *func) {
+	int size = 0;
+	for (auto block: func->blocks)
+		size += static_cast<int>(block->phis.size() + block->stmts.size());
+	return size;
+}
+
+/// @brief strongly connected components of the call graph by Tarjan's algorithm, callees before their callers
+class CallGraph {
+	std::map<Function *, std::vector<Function *>> callees;
+	std::map<Function *, int> index, low;
+	std::vector<Function *> stack;
+	std::set<Function *> onStack;
+
+public:
+	std::vector<std::vector<Function *>> sccs;
+	std::map<Function *, int> sccOf;
+	std::map<Function *, int> callSites;
+
+	explicit CallGraph(Module *module) {
+		for (auto func: module->functions)
+			for (auto block: func->blocks)
+				for (auto stmt: block->stmts)
+					if (auto call = dynamic_cast<CallStmt *>(stmt); call && !call->func->blocks.empty()) {
+						callees[func].push_back(call->func);
+						++callSites[call->func];
+					}
+		for (auto func: module->functions)
+			if (!func->blocks.empty() && !index.contains(func)) visit(func);
+	}
+
+private:
+	void visit(Function *func) {
+		index[func] = low[func] = static_cast<int>(index.size());
+		stack.push_back(func);
+		onStack.insert(func);
+		for (auto callee: callees[func]) {
+			if (!index.contains(callee)) {
+				visit(callee);
+				low[func] = std::min(low[func], low[callee]);
+			}
+			else if (onStack.contains(callee))
+				low[func] = std::min(low[func], index[callee]);
+		}
+		if (low[func] != index[func]) return;
+		auto &scc = sccs.emplace_back();
+		Function *top;
+		do {
+			top = stack.back();
+			stack.pop_back();
+			onStack.erase(top);
+			sccOf[top] = static_cast<int>(sccs.size()) - 1;
+			scc.push_back(top);
+		} while (top != func);
+	}
+};
+
+class FunctionInliner {
+	Wrapper &env;
+	CallGraph &graph;
+	int threshold;
+
+public:
+	FunctionInliner(Wrapper &env, CallGraph &graph, int threshold) : env(env), graph(graph), threshold(threshold) {}
+
+	void work(Function *caller) {
+		std::vector<CallStmt *> calls;
+		for (auto block: caller->blocks)
+			for (auto stmt: block->stmts)
+				if (auto call = dynamic_cast<CallStmt *>(stmt); call && worth(caller, call)) calls.push_back(call);
+		int size = size_of(caller);
+		for (auto call: calls) {
+			auto calleeSize = size_of(call->func);
+			if (calleeSize > alwaysInlineSize && size + calleeSize > maxCallerSize) continue;
+			// the call may have moved to a block split off by an earlier one
+			for (auto block: caller->blocks)
+				if (auto it = std::ranges::find(block->stmts, call); it != block->stmts.end()) {
+					inline_call(caller, block, it);
+					break;
+				}
+			size += calleeSize;
+		}
+	}
+
+private:
+	bool worth(Function *caller, CallStmt *call) {
+		// -O0 inlines nothing
+		if (threshold < 0) return false;
+		auto callee = call->func;
+		if (callee->blocks.empty() || graph.sccOf[callee] == graph.sccOf[caller]) return false;
+		if (!callee->blocks.front()->phis.empty()) return false;
+		for (auto block: callee->blocks)
+			for (auto stmt: block->stmts)
+				if (dynamic_cast<AllocaStmt *>(stmt)) return false;
+		// a null argument cannot take the place of the pointer operand of a load or store
+		for (auto arg: call->args)
+			if (dynamic_cast<LiteralNull *>(arg)) return false;
+		auto size = size_of(callee);
+		if (size <= alwaysInlineSize) return true;
+		// the call moves its arguments and saves the caller-saved registers around it
+		int benefit = 4 + static_cast<int>(call->args.size());
+		for (auto arg: call->args)
+			if (dynamic_cast<Literal *>(arg)) benefit += 2;
+		// the only call of a function leaves no copy of it behind
+		int limit = graph.callSites[callee] == 1 ? 2 * threshold : threshold;
+		return size - benefit <= limit;
+	}
+
+	/// @brief B: ..., call f, rest becomes
+	/// B: ..., br f.entry'; the blocks of f with every ret being a br to R
+	/// R: phi of the returned values, rest
+	void inline_call(Function *caller, BasicBlock *block, std::list<Stmt *>::iterator it) {
+		auto call = dynamic_cast<CallStmt *>(*it);
+		auto callee = call->func;
+		auto after = env.create_annoy_block("inline_ret_");
+		after->stmts.splice(after->stmts.end(), block->stmts, std::next(it), block->stmts.end());
+		block->stmts.erase(it);
+		for (auto succ: successors_of(after))
+			for (auto [res, phi]: succ->phis)
+				if (auto p = phi->branches.find(block); p != phi->branches.end()) {
+					phi->branches[after] = p->second;
+					phi->branches.erase(p);
+				}
+
+		Cloner copy(env, ".inline.");
+		for (size_t i = 0; i < call->args.size(); ++i)
+			copy.val[callee->paramsVar[i]] = call->args[i];
+		for (auto from: callee->blocks) {
+			copy.block[from] = env.create_annoy_block(from->label + "_inl_");
+			for (auto [res, phi]: from->phis)
+				copy.fresh(res);
+			for (auto stmt: from->stmts)
+				if (auto def = stmt->getDef()) copy.fresh(def);
+		}
+		std::map<BasicBlock *, Val *> returns;
+		std::vector<BasicBlock *> copied;
+		for (auto from: callee->blocks) {
+			auto to = copy(from);
+			copied.push_back(to);
+			for (auto [res, phi]: from->phis)
+				to->phis[copy(res)] = dynamic_cast<PhiStmt *>(copy.clone(phi));
+			for (auto stmt: from->stmts)
+				if (auto ret = dynamic_cast<RetStmt *>(stmt)) {
+					returns[to] = ret->value ? copy(ret->value) : nullptr;
+					to->stmts.push_back(env.createDirectBrStmt(after));
+				}
+				else
+					to->stmts.push_back(copy.clone(stmt));
+		}
+		block->stmts.push_back(env.createDirectBrStmt(copied.front()));
+
+		if (call->res && !returns.empty()) {
+			auto single = dynamic_cast<Var *>(returns.begin()->second);
+			if (returns.size() == 1 && single) {
+				for (auto b: caller->blocks) {
+					for (auto [res, phi]: b->phis)
+						phi->replaceUse(call->res, single);
+					for (auto stmt: b->stmts)
+						stmt->replaceUse(call->res, single);
+				}
+				for (auto stmt: after->stmts)
+					stmt->replaceUse(call->res, single);
+			}
+			else
+				after->phis[call->res] = env.createPhiStmt(call->res, returns);
+		}
+		copied.push_back(after);
+		caller->blocks.insert(std::next(std::ranges::find(caller->blocks, block)), copied.begin(), copied.end());
+	}
+};
+
+}// namespace
+
+void Inliner::work() {
+	auto module = env.get_module();
+	CallGraph graph(module);
+	FunctionInliner inliner(env, graph, threshold_of(level));
+	for (auto const &scc: graph.sccs)
+		for (auto func: scc)
+			inliner.work(func);
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include "IR/Wrapper.h"
+
+namespace IR {
+
+/// @brief function inlining, bottom-up on the call graph.
+/// a call is replaced by a copy of the callee when the callee is tiny, or when its size less what the call costs is
+/// within the threshold of the optimization level. calls inside a cycle of the call graph are kept.
+class Inliner {
+public:
+	Inliner(Wrapper &env, int level) : env(env), level(level) {}
+	void work();
+
+private:
+	Wrapper &env;
+	int level;
+};
+
+}// namespace IR
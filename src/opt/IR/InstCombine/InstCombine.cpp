@@ -0,0 +1,256 @@
+#include "InstCombine.h"
+#include "opt/IR/ConstFold/ConstFold.h"
+#include <climits>
+#include <map>
+#include <optional>
+#include <set>
+
+using namespace IR;
+
+namespace {
+
+class Combiner {
+	Wrapper &env;
+	Function *func;
+
+public:
+	Combiner(Wrapper &wrapper, Function *function) : env(wrapper), func(function) {}
+	void work();
+
+private:
+	std::map<Val *, Val *> substitute;
+	std::set<Stmt *> removed;
+	std::map<Var *, Stmt *> def;
+
+	Val *find(Val *val);
+	Val *literal(Var *res, int value);
+	bool replace_by(Stmt *stmt, Val *val);
+	ArithmeticStmt *arithmetic_def(Val *val, std::string const &cmd);
+
+	bool combine(ArithmeticStmt *node, Stmt *&slot);
+	bool combine(IcmpStmt *node);
+	bool combine(SelectStmt *node, Stmt *&slot);
+	void remove_unused();
+};
+
+}// namespace
+
+void InstCombine::work() {
+	auto module = env.get_module();
+	for (auto function: module->functions)
+		if (!function->blocks.empty())
+			Combiner(env, function).work();
+}
+
+void Combiner::work() {
+	for (auto block: func->blocks)
+		for (auto stmt: block->stmts)
+			if (auto var = stmt->getDef()) def[var] = stmt;
+
+	bool changed = true;
+	while (changed) {
+		changed = false;
+		for (auto block: func->blocks)
+			for (auto &stmt: block->stmts) {
+				if (removed.contains(stmt)) continue;
+				for (auto use: stmt->getUse())
+					if (auto to = find(use); to != use)
+						stmt->replaceUse(use, to);
+				if (auto arith = dynamic_cast<ArithmeticStmt *>(stmt))
+					changed |= combine(arith, stmt);
+				else if (auto icmp = dynamic_cast<IcmpStmt *>(stmt))
+					changed |= combine(icmp);
+				else if (auto select = dynamic_cast<SelectStmt *>(stmt))
+					changed |= combine(select, stmt);
+			}
+	}
+
+	for (auto block: func->blocks) {
+		std::erase_if(block->stmts, [&](Stmt *stmt) { return removed.contains(stmt); });
+		auto rewrite = [&](Stmt *stmt) {
+			for (auto use: stmt->getUse())
+				if (auto to = find(use); to != use)
+					stmt->replaceUse(use, to);
+		};
+		for (auto [res, phi]: block->phis)
+			rewrite(phi);
+		for (auto stmt: block->stmts)
+			rewrite(stmt);
+	}
+	remove_unused();
+}
+
+Val *Combiner::find(Val *val) {
+	while (substitute.contains(val))
+		val = substitute[val];
+	return val;
+}
+
+Val *Combiner::literal(Var *res, int value) {
+	if (res->type == env.boolType)
+		return env.get_literal_bool(value & 1);
+	return env.get_literal_int(value);
+}
+
+bool Combiner::replace_by(Stmt *stmt, Val *val) {
+	substitute[stmt->getDef()] = val;
+	removed.insert(stmt);
+	return true;
+}
+
+ArithmeticStmt *Combiner::arithmetic_def(Val *val, std::string const &cmd) {
+	auto var = dynamic_cast<Var *>(val);
+	auto p = var ? def.find(var) : def.end();
+	if (p == def.end() || removed.contains(p->second)) return nullptr;
+	auto arith = dynamic_cast<ArithmeticStmt *>(p->second);
+	return arith && arith->cmd == cmd ? arith : nullptr;
+}
+
+bool Combiner::combine(ArithmeticStmt *node, Stmt *&slot) {
+	auto &cmd = node->cmd;
+	auto l = literal_of(node->lhs), r = literal_of(node->rhs);
+	if (l && r) return replace_by(node, literal(node->res, calc_arithmetic(cmd, *l, *r)));
+	bool changed = false;
+	if (l && is_commutative(cmd)) {
+		std::swap(node->lhs, node->rhs);
+		std::swap(l, r);
+		changed = true;
+	}
+	auto x = node->lhs;
+	int ones = node->res->type == env.boolType ? 1 : -1;
+
+	if (x == node->rhs) {
+		if (cmd == "sub" || cmd == "xor") return replace_by(node, literal(node->res, 0));
+		if (cmd == "and" || cmd == "or") return replace_by(node, x);
+	}
+	// -(-y) = y, x + (-y) = x - y
+	if (auto neg = arithmetic_def(node->rhs, "sub"); neg && literal_of(neg->lhs) == 0) {
+		if (cmd == "sub" && l == 0) return replace_by(node, neg->rhs);
+		if (cmd == "add") {
+			cmd = "sub";
+			node->rhs = neg->rhs;
+			return true;
+		}
+	}
+	if (!r) return changed;
+
+	int c = *r;
+	if (cmd == "sub") {
+		cmd = "add";
+		node->rhs = literal(node->res, calc_arithmetic("sub", 0, c));
+		return true;
+	}
+	if (c == 0 && (cmd == "add" || cmd == "or" || cmd == "xor" || cmd == "shl" || cmd == "ashr"))
+		return replace_by(node, x);
+	if (c == 0 && (cmd == "mul" || cmd == "and"))
+		return replace_by(node, literal(node->res, 0));
+	if (c == 1 && (cmd == "mul" || cmd == "sdiv"))
+		return replace_by(node, x);
+	if ((c == 1 || c == -1) && cmd == "srem")
+		return replace_by(node, literal(node->res, 0));
+	if (c == ones && cmd == "and") return replace_by(node, x);
+	if (c == ones && cmd == "or") return replace_by(node, literal(node->res, ones));
+	if (c == -1 && cmd == "sdiv") {
+		cmd = "sub";
+		node->lhs = literal(node->res, 0);
+		node->rhs = x;
+		return true;
+	}
+
+	// (y op c1) op c2 = y op (c1 op c2)
+	if (auto inner = arithmetic_def(x, cmd)) {
+		auto c1 = literal_of(inner->rhs);
+		if (c1 && (is_commutative(cmd) || ((cmd == "shl" || cmd == "ashr") && 0 <= *c1 && *c1 < 32 && 0 <= c && c < 32))) {
+			int merged = is_commutative(cmd) ? calc_arithmetic(cmd, *c1, c) : *c1 + c;
+			if (cmd == "shl" && merged >= 32) return replace_by(node, literal(node->res, 0));
+			if (cmd == "ashr" && merged >= 32) merged = 31;
+			node->lhs = inner->lhs;
+			node->rhs = literal(node->res, merged);
+			return true;
+		}
+	}
+
+	// !(a < b) = a >= b
+	if (cmd == "xor" && node->res->type == env.boolType && c == 1)
+		if (auto p = def.find(dynamic_cast<Var *>(x)); p != def.end() && !removed.contains(p->second))
+			if (auto icmp = dynamic_cast<IcmpStmt *>(p->second)) {
+				auto inv = env.createIcmpStmt(inverted(icmp->cmd), node->res, find(icmp->lhs), find(icmp->rhs));
+				def[node->res] = slot = inv;
+				return true;
+			}
+	return changed;
+}
+
+bool Combiner::combine(IcmpStmt *node) {
+	auto &cmd = node->cmd;
+	auto l = literal_of(node->lhs), r = literal_of(node->rhs);
+	if (l && r) return replace_by(node, env.get_literal_bool(calc_icmp(cmd, *l, *r)));
+	if (node->lhs == node->rhs)
+		return replace_by(node, env.get_literal_bool(cmd == "eq" || cmd == "sle" || cmd == "sge"));
+	if (l) {
+		std::swap(node->lhs, node->rhs);
+		cmd = swapped(cmd);
+		return true;
+	}
+	if (!r) return false;
+
+	if (dynamic_cast<LiteralBool *>(node->rhs) && (cmd == "eq" || cmd == "ne") && (cmd == "eq") == *r)
+		return replace_by(node, node->lhs);
+	// the strict forms are a single slt(i) in the backend
+	if (dynamic_cast<LiteralInt *>(node->rhs)) {
+		if (cmd == "sle" && *r != INT_MAX) {
+			cmd = "slt";
+			node->rhs = env.get_literal_int(*r + 1);
+			return true;
+		}
+		if (cmd == "sge" && *r != INT_MIN) {
+			cmd = "sgt";
+			node->rhs = env.get_literal_int(*r - 1);
+			return true;
+		}
+	}
+	return false;
+}
+
+bool Combiner::combine(SelectStmt *node, Stmt *&slot) {
+	if (auto cond = literal_of(node->cond)) return replace_by(node, *cond ? node->trueVal : node->falseVal);
+	if (node->trueVal == node->falseVal) return replace_by(node, node->trueVal);
+	auto t = dynamic_cast<LiteralBool *>(node->trueVal), f = dynamic_cast<LiteralBool *>(node->falseVal);
+	if (!t || !f) return false;
+	// c ? true : false = c, c ? false : true = !c
+	if (t->value) return replace_by(node, node->cond);
+	auto inv = env.createArithmeticStmt("xor", node->res, node->cond, env.get_literal_bool(true));
+	def[node->res] = slot = inv;
+	return true;
+}
+
+void Combiner::remove_unused() {
+	std::map<Var *, int> uses;
+	for (auto block: func->blocks) {
+		for (auto [res, phi]: block->phis)
+			for (auto use: phi->getUse())
+				if (auto var = dynamic_cast<Var *>(use)) ++uses[var];
+		for (auto stmt: block->stmts)
+			for (auto use: stmt->getUse())
+				if (auto var = dynamic_cast<Var *>(use)) ++uses[var];
+	}
+	std::set<Stmt *> dead;
+	std::vector<Stmt *> work;
+	auto check = [&](Stmt *stmt) {
+		if ((dynamic_cast<ArithmeticStmt *>(stmt) || dynamic_cast<IcmpStmt *>(stmt) || dynamic_cast<SelectStmt *>(stmt)) &&
+			!uses[stmt->getDef()] && dead.insert(stmt).second)
+			work.push_back(stmt);
+	};
+	for (auto block: func->blocks)
+		for (auto stmt: block->stmts)
+			check(stmt);
+	while (!work.empty()) {
+		auto stmt = work.back();
+		work.pop_back();
+		for (auto use: stmt->getUse())
+			if (auto var = dynamic_cast<Var *>(use); var && --uses[var] == 0 && def.contains(var) && !removed.contains(def[var]))
+				check(def[var]);
+	}
+	for (auto block: func->blocks)
+		std::erase_if(block->stmts, [&](Stmt *stmt) { return dead.contains(stmt); });
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include "IR/Wrapper.h"
+
+namespace IR {
+
+/// @brief algebraic simplification of arithmetic and icmp stmts.
+/// folds identities (`x + 0`, `x * 1`, `x - x`, `x ^ x`, `-(-x)`), puts the constant on the right, reassociates
+/// `(x op c1) op c2`, merges shifts of shifts, turns `!(a < b)` into `a >= b` and folds selects of bool literals;
+/// stmts left unused are dropped.
+class InstCombine {
+public:
+	explicit InstCombine(Wrapper &env) : env(env) {}
+	void work();
+
+private:
+	Wrapper &env;
+};
+
+}// namespace IR
@@ -0,0 +1,170 @@
+#include "JumpThreading.h"
+#include "IR/Cloner.h"
+#include "opt/IR/Analysis/CFG.h"
+#include "opt/IR/Analysis/DomTree.h"
+#include "opt/IR/Analysis/LoopInfo.h"
+#include "opt/IR/ConstFold/ConstFold.h"
+#include <algorithm>
+#include <map>
+#include <optional>
+
+using namespace IR;
+
+namespace {
+
+constexpr int maxBlockSize = 8;// stmts of a block copied for a single predecessor
+constexpr int budget = 64;     // stmts copied in a function
+
+class Threader {
+	Wrapper &env;
+	Function *func;
+
+public:
+	Threader(Wrapper &wrapper, Function *function) : env(wrapper), func(function) {}
+	bool work();
+
+private:
+	int spent = 0;
+	std::map<Var *, std::vector<std::pair<Stmt *, BasicBlock *>>> users;
+
+	bool thread(CFG &cfg, DomTree &dom, LoopInfo &info, BasicBlock *block);
+	[[nodiscard]] bool used_locally(BasicBlock *block, Var *var) const;
+	std::optional<bool> outcome(BasicBlock *block, BasicBlock *pred);
+};
+
+void retarget(Stmt *terminator, BasicBlock *from, BasicBlock *to) {
+	if (auto dir = dynamic_cast<DirectBrStmt *>(terminator))
+		dir->block = to;
+	else if (auto br = dynamic_cast<CondBrStmt *>(terminator)) {
+		if (br->trueBlock == from) br->trueBlock = to;
+		if (br->falseBlock == from) br->falseBlock = to;
+	}
+}
+
+}// namespace
+
+void JumpThreading::work() {
+	bool changed = false;
+	for (auto func: env.get_module()->functions)
+		if (!func->blocks.empty())
+			changed |= Threader(env, func).work();
+	// the bypassed blocks may be left without predecessors, and their phis with a single value
+	if (changed) ConstFold(env).work();
+}
+
+bool Threader::work() {
+	bool changed = false, again = true;
+	while (again && spent < budget) {
+		again = false;
+		users.clear();
+		for (auto block: func->blocks) {
+			for (auto [res, phi]: block->phis)
+				for (auto use: phi->getUse())
+					if (auto var = dynamic_cast<Var *>(use)) users[var].emplace_back(phi, block);
+			for (auto stmt: block->stmts)
+				for (auto use: stmt->getUse())
+					if (auto var = dynamic_cast<Var *>(use)) users[var].emplace_back(stmt, block);
+		}
+		CFG cfg(func);
+		DomTree dom(cfg);
+		LoopInfo info(cfg);
+		// the cfg is stale after a change, start over
+		for (auto block: cfg.rpo)
+			if (thread(cfg, dom, info, block)) {
+				again = changed = true;
+				break;
+			}
+	}
+	return changed;
+}
+
+bool Threader::used_locally(BasicBlock *block, Var *var) const {
+	auto p = users.find(var);
+	if (p == users.end()) return true;
+	auto succ = successors_of(block);
+	return std::ranges::all_of(p->second, [&](auto const &user) {
+		auto [stmt, at] = user;
+		auto phi = dynamic_cast<PhiStmt *>(stmt);
+		if (!phi) return at == block;
+		// the value must flow in along an edge leaving `block`, not from another predecessor
+		return at != block && std::ranges::find(succ, at) != succ.end() &&
+			   std::ranges::all_of(phi->branches, [&](auto const &entry) { return entry.second != var || entry.first == block; });
+	});
+}
+
+std::optional<bool> Threader::outcome(BasicBlock *block, BasicBlock *pred) {
+	std::map<Val *, Val *> known;
+	for (auto [res, phi]: block->phis)
+		known[res] = phi->branches[pred];
+	auto get = [&](Val *val) {
+		auto p = known.find(val);
+		return p == known.end() ? val : p->second;
+	};
+	for (auto stmt: block->stmts) {
+		auto arith = dynamic_cast<ArithmeticStmt *>(stmt);
+		auto icmp = dynamic_cast<IcmpStmt *>(stmt);
+		if (!arith && !icmp) continue;
+		auto lhs = literal_of(get(arith ? arith->lhs : icmp->lhs)), rhs = literal_of(get(arith ? arith->rhs : icmp->rhs));
+		if (!lhs || !rhs) continue;
+		if (icmp)
+			known[icmp->res] = env.get_literal_bool(calc_icmp(icmp->cmd, *lhs, *rhs));
+		else if (arith->res->type == env.boolType)
+			known[arith->res] = env.get_literal_bool(calc_arithmetic(arith->cmd, *lhs, *rhs));
+		else
+			known[arith->res] = env.get_literal_int(calc_arithmetic(arith->cmd, *lhs, *rhs));
+	}
+	if (auto cond = dynamic_cast<LiteralBool *>(get(dynamic_cast<CondBrStmt *>(block->stmts.back())->cond)))
+		return cond->value;
+	return std::nullopt;
+}
+
+bool Threader::thread(CFG &cfg, DomTree &dom, LoopInfo &info, BasicBlock *block) {
+	auto br = dynamic_cast<CondBrStmt *>(block->stmts.back());
+	if (!br || br->trueBlock == br->falseBlock || block->phis.empty()) return false;
+	int size = static_cast<int>(block->stmts.size()) - 1;
+	if (size > maxBlockSize) return false;
+	for (auto [res, phi]: block->phis)
+		if (!used_locally(block, res)) return false;
+	for (auto stmt: block->stmts) {
+		if (dynamic_cast<AllocaStmt *>(stmt)) return false;
+		if (auto def = stmt->getDef(); def && !used_locally(block, def)) return false;
+	}
+	bool header = std::ranges::any_of(cfg.predecessors[block], [&](BasicBlock *pred) { return dom.dominates(block, pred); });
+
+	for (auto pred: cfg.predecessors[block]) {
+		// entering a loop past its header would make it irreducible
+		if (pred == block || !dom.contains(pred) || (header && !dom.dominates(block, pred))) continue;
+		auto taken = outcome(block, pred);
+		if (!taken) continue;
+		auto to = *taken ? br->trueBlock : br->falseBlock;
+		// a back edge may only skip the header to leave the loop, or the body becomes a second entry into itself
+		if (header && info.loopOf.contains(block) && info.loopOf[block]->contains(to)) continue;
+		auto preds = cfg.predecessors[to];
+		bool shared = std::ranges::find(preds, pred) != preds.end() && !to->phis.empty();
+		if (spent + size + 1 > budget) return false;
+
+		Cloner cloner(env, ".thread.");
+		for (auto [res, phi]: block->phis)
+			cloner.val[res] = phi->branches[pred];
+		auto from = pred;
+		if (size || shared) {
+			// a copy of the block for `pred` alone, jumping to `to`
+			auto copy = env.create_annoy_block("thread_");
+			for (auto stmt: block->stmts)
+				if (stmt != br) copy->stmts.push_back(cloner.clone(stmt));
+			copy->stmts.push_back(env.createDirectBrStmt(to));
+			func->blocks.insert(std::ranges::find(func->blocks, block), copy);
+			retarget(pred->stmts.back(), block, copy);
+			from = copy;
+		}
+		else
+			retarget(pred->stmts.back(), block, to);
+		for (auto [res, phi]: to->phis)
+			phi->branches[from] = cloner(phi->branches[block]);
+		for (auto [res, phi]: block->phis)
+			phi->branches.erase(pred);
+		spent += size + 1;
+		return true;
+	}
+	return false;
+}
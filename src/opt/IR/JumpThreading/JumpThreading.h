@@ -0,0 +1,19 @@
+#pragma once
+#include "IR/Wrapper.h"
+
+namespace IR {
+
+/// @brief jump threading.
+/// a predecessor whose incoming phi values decide the branch ending a block gets its own copy of the block, which
+/// jumps straight to the successor taken (a block without stmts is bypassed instead). only small blocks whose values
+/// are used inside the block or by the phis of its successors are copied, within a budget per function.
+class JumpThreading {
+public:
+	explicit JumpThreading(Wrapper &env) : env(env) {}
+	void work();
+
+private:
+	Wrapper &env;
+};
+
+}// namespace IR
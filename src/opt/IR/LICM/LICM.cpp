@@ -0,0 +1,287 @@
+#include "LICM.h"
+#include "opt/IR/Analysis/Alias.h"
+#include "opt/IR/Analysis/DomTree.h"
+#include "opt/IR/Analysis/LoopInfo.h"
+#include "opt/IR/ConstFold/ConstFold.h"
+#include "opt/IR/LoopSimplify/LoopSimplify.h"
+#include <algorithm>
+#include <functional>
+#include <set>
+
+using namespace IR;
+
+namespace {
+
+class LoopMotion {
+	Wrapper &env;
+	SideEffect const &effect;
+	ModRef const &modRef;
+	Function *func;
+
+public:
+	LoopMotion(Wrapper &env, SideEffect const &effect, ModRef const &modRef, Function *func)
+		: env(env), effect(effect), modRef(modRef), func(func) {}
+	void work() {
+		LoopSimplify(env).work(func);
+		AliasAnalysis aa(func, effect, modRef);
+		alias = &aa;
+		for (auto block: func->blocks)
+			for (auto stmt: block->stmts)
+				if (auto gep = dynamic_cast<GetElementPtrStmt *>(stmt))
+					gepOf[gep->res] = gep;
+		CFG cfg(func);
+		LoopInfo info(cfg);
+		DomTree dom(cfg);
+		for (auto loop: info.inner_to_outer())
+			if (loop->preheader)
+				run(cfg, dom, loop);
+	}
+
+private:
+	std::map<Var *, BasicBlock *> defBlock;
+	std::map<Var *, GetElementPtrStmt *> gepOf;
+	AliasAnalysis const *alias = nullptr;
+	std::vector<std::pair<Var *, Type *>> loaded, stored;
+	std::vector<CallStmt *> calls;
+
+	void run(CFG &cfg, DomTree &dom, Loop *loop) {
+		defBlock.clear(), loaded.clear(), stored.clear(), calls.clear();
+		std::vector<BasicBlock *> blocks;
+		for (auto block: cfg.rpo)
+			if (loop->contains(block)) blocks.push_back(block);
+		for (auto block: blocks) {
+			for (auto [res, phi]: block->phis)
+				defBlock[res] = block;
+			for (auto stmt: block->stmts) {
+				if (auto def = stmt->getDef())
+					defBlock[def] = block;
+				if (auto load = dynamic_cast<LoadStmt *>(stmt))
+					loaded.emplace_back(load->pointer, load->res->type);
+				else if (auto store = dynamic_cast<StoreStmt *>(stmt))
+					stored.emplace_back(store->pointer, store->value->type);
+				else if (auto call = dynamic_cast<CallStmt *>(stmt))
+					calls.push_back(call);
+			}
+		}
+		std::vector<BasicBlock *> exiting;
+		for (auto block: blocks)
+			if (std::ranges::any_of(cfg.successors[block], [loop](auto to) { return !loop->contains(to); }))
+				exiting.push_back(block);
+		auto guaranteed = [&](BasicBlock *block) {
+			return std::ranges::all_of(exiting, [&](auto x) { return dom.dominates(block, x); });
+		};
+
+		auto preheader = loop->preheader;
+		std::vector<Stmt *> hoisted;
+		for (auto block: blocks) {
+			bool always = guaranteed(block);
+			for (auto it = block->stmts.begin(); it != block->stmts.end();) {
+				if (invariant(*it) && can_hoist(*it, always)) {
+					hoisted.push_back(*it);
+					defBlock.erase((*it)->getDef());
+					it = block->stmts.erase(it);
+				}
+				else
+					++it;
+			}
+		}
+		preheader->stmts.insert(std::prev(preheader->stmts.end()), hoisted.begin(), hoisted.end());
+
+		for (auto block: blocks) {
+			if (!guaranteed(block)) continue;
+			for (auto it = block->stmts.begin(); it != block->stmts.end();) {
+				auto store = dynamic_cast<StoreStmt *>(*it);
+				if (store && can_sink(store, block)) {
+					for (auto exit: loop->exits) {
+						auto pos = exit->stmts.begin();
+						exit->stmts.insert(pos, env.createStoreStmt(store->value, store->pointer));
+					}
+					it = block->stmts.erase(it);
+				}
+				else
+					++it;
+			}
+		}
+
+		// what stays in memory across iterations is kept in a register instead
+		if (!loop->has_dedicated_exits(cfg)) return;
+		std::set<Var *> promoted;
+		for (auto [pointer, type]: std::vector(stored))
+			if (invariant(pointer) && !promoted.contains(pointer) && can_promote(pointer, type, blocks, guaranteed)) {
+				promote(cfg, loop, blocks, pointer, type);
+				promoted.insert(pointer);
+			}
+	}
+
+	[[nodiscard]] std::size_t count_alias(std::vector<std::pair<Var *, Type *>> const &list, Var *pointer, Type *type) const {
+		return std::ranges::count_if(list, [&](auto const &x) { return alias->may_alias(x.first, x.second, pointer, type); });
+	}
+	/// @return whether a store or a call of the loop may write what `pointer` points to
+	[[nodiscard]] bool clobbered(Var *pointer, Type *type) const {
+		return count_alias(stored, pointer, type) ||
+			   std::ranges::any_of(calls, [&](CallStmt *call) { return alias->may_modify(call, pointer); });
+	}
+	/// @return whether a load or a call of the loop may read what `pointer` points to
+	[[nodiscard]] bool observed(Var *pointer, Type *type) const {
+		return count_alias(loaded, pointer, type) ||
+			   std::ranges::any_of(calls, [&](CallStmt *call) { return alias->may_read(call, pointer); });
+	}
+	/// @brief loading can not fault: a global or a field of `this`
+	[[nodiscard]] bool dereferenceable(Var *pointer) const {
+		if (dynamic_cast<GlobalVar *>(pointer)) return true;
+		auto p = gepOf.find(pointer);
+		return p != gepOf.end() && p->second->typeName.starts_with("%class.") && !func->params.empty() &&
+			   func->params.front().second == "this" && p->second->pointer == func->paramsVar.front();
+	}
+
+	[[nodiscard]] bool invariant(Val *val) const {
+		auto var = dynamic_cast<Var *>(val);
+		return !var || !defBlock.contains(var);
+	}
+	[[nodiscard]] bool invariant(Stmt *stmt) const {
+		return stmt->getDef() && std::ranges::all_of(stmt->getUse(), [this](Val *val) { return invariant(val); });
+	}
+
+	[[nodiscard]] bool can_hoist(Stmt *stmt, bool always) const {
+		if (dynamic_cast<IcmpStmt *>(stmt) || dynamic_cast<SelectStmt *>(stmt) || dynamic_cast<GetElementPtrStmt *>(stmt))
+			return true;
+		if (auto arith = dynamic_cast<ArithmeticStmt *>(stmt)) {
+			if (arith->cmd != "sdiv" && arith->cmd != "srem") return true;
+			auto divisor = dynamic_cast<LiteralInt *>(arith->rhs);
+			return always || (divisor && divisor->value != 0);
+		}
+		if (auto load = dynamic_cast<LoadStmt *>(stmt))
+			return (always || dereferenceable(load->pointer)) && !clobbered(load->pointer, load->res->type);
+		// the loop might not have called it at all
+		if (!always) return false;
+		if (auto call = dynamic_cast<CallStmt *>(stmt))
+			return call->func->blocks.empty() && effect.pure(call->func) && !AliasAnalysis::allocates(call->func);
+		return false;
+	}
+
+	/// @brief the loop stores to what `pointer` points to, every access of the loop to it goes through it and no call
+	/// sees it, and loading it before the loop can not fault
+	[[nodiscard]] bool can_promote(Var *pointer, Type *type, std::vector<BasicBlock *> const &blocks,
+								   std::function<bool(BasicBlock *)> const &guaranteed) const {
+		if (std::ranges::any_of(calls, [&](CallStmt *call) { return alias->may_read(call, pointer) || alias->may_modify(call, pointer); }))
+			return false;
+		bool safe = dereferenceable(pointer), stores = false;
+		for (auto block: blocks)
+			for (auto stmt: block->stmts) {
+				auto [p, t] = access_of(stmt);
+				if (!p) continue;
+				auto result = alias->alias(p, t, pointer, type);
+				if (result == AliasAnalysis::NoAlias) continue;
+				if (result != AliasAnalysis::MustAlias) return false;
+				safe |= guaranteed(block);
+				stores |= dynamic_cast<StoreStmt *>(stmt) != nullptr;
+			}
+		return safe && stores;
+	}
+	[[nodiscard]] static std::pair<Var *, Type *> access_of(Stmt *stmt) {
+		if (auto load = dynamic_cast<LoadStmt *>(stmt)) return {load->pointer, load->res->type};
+		if (auto store = dynamic_cast<StoreStmt *>(stmt)) return {store->pointer, store->value->type};
+		return {nullptr, nullptr};
+	}
+
+	/// @brief load `pointer` in the preheader, carry its value through the loop in phis and store it at the exits
+	void promote(CFG &cfg, Loop *loop, std::vector<BasicBlock *> const &blocks, Var *pointer, Type *type) {
+		auto preheader = loop->preheader;
+		auto init = env.create_annoy_var(type, ".promote.");
+		preheader->stmts.insert(std::prev(preheader->stmts.end()), env.createLoadStmt(init, pointer));
+
+		std::map<Val *, Val *> substitute;
+		auto find = [&](Val *val) {
+			while (substitute.contains(val)) val = substitute[val];
+			return val;
+		};
+		std::map<BasicBlock *, Val *> out{{preheader, init}};// the value at the end of a block
+		auto out_of = [&](BasicBlock *block) { return out.contains(block) ? out[block] : init; };
+		std::vector<std::pair<BasicBlock *, PhiStmt *>> phis;
+		auto merge = [&](BasicBlock *block) -> Val * {
+			auto &preds = cfg.predecessors[block];
+			if (preds.size() == 1) return out_of(preds.front());
+			auto phi = env.createPhiStmt(env.create_annoy_var(type, ".promote."));
+			block->phis[phi->res] = phi;
+			phis.emplace_back(block, phi);
+			return phi->res;
+		};
+		for (auto block: blocks) {
+			auto cur = merge(block);
+			for (auto it = block->stmts.begin(); it != block->stmts.end();) {
+				auto [p, t] = access_of(*it);
+				if (!p || alias->alias(p, t, pointer, type) != AliasAnalysis::MustAlias) {
+					++it;
+					continue;
+				}
+				if (auto load = dynamic_cast<LoadStmt *>(*it))
+					substitute[load->res] = cur;
+				else
+					cur = dynamic_cast<StoreStmt *>(*it)->value;
+				it = block->stmts.erase(it);
+			}
+			out[block] = cur;
+		}
+		for (auto exit: loop->exits)
+			exit->stmts.push_front(env.createStoreStmt(merge(exit), pointer));
+		for (auto [block, phi]: phis)
+			for (auto pred: cfg.predecessors[block])
+				phi->branches[pred] = out_of(pred);
+
+		// a phi merging a single value is that value
+		for (bool changed = true; changed;) {
+			changed = false;
+			for (auto &[block, phi]: phis) {
+				if (!phi) continue;
+				Val *same = nullptr;
+				bool trivial = true;
+				for (auto [pred, val]: phi->branches)
+					if (val = find(val); val != phi->res && val != same) {
+						trivial &= !same;
+						same = val;
+					}
+				if (trivial && same) {
+					substitute[phi->res] = same;
+					block->phis.erase(phi->res);
+					phi = nullptr;
+					changed = true;
+				}
+			}
+		}
+		auto rewrite = [&](Stmt *stmt) {
+			for (auto use: stmt->getUse())
+				if (auto to = find(use); to != use)
+					stmt->replaceUse(use, to);
+		};
+		for (auto block: func->blocks) {
+			for (auto [res, phi]: block->phis)
+				rewrite(phi);
+			for (auto stmt: block->stmts)
+				rewrite(stmt);
+		}
+	}
+
+	/// @brief the last store of the loop is the only one anybody sees
+	[[nodiscard]] bool can_sink(StoreStmt *store, BasicBlock *block) const {
+		if (!invariant(store->pointer)) return false;
+		auto type = store->value->type;
+		if (observed(store->pointer, type) ||
+			std::ranges::any_of(calls, [&](CallStmt *call) { return alias->may_modify(call, store->pointer); }))
+			return false;
+		// the value has to be the one of the last store, so it is computed next to it or before the loop
+		if (auto var = dynamic_cast<Var *>(store->value); var && defBlock.contains(var) && defBlock.at(var) != block)
+			return false;
+		return count_alias(stored, store->pointer, type) == 1;
+	}
+};
+
+}// namespace
+
+void LICM::work() {
+	SideEffect effect(env.get_module());
+	ModRef modRef(env.get_module());
+	for (auto func: env.get_module()->functions)
+		if (!func->blocks.empty())
+			LoopMotion(env, effect, modRef, func).work();
+	ConstFold(env).work();
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include "IR/Wrapper.h"
+
+namespace IR {
+
+/// @brief loop invariant code motion.
+/// invariant computations move to the preheader; a store to an invariant address no other access in the loop can see
+/// sinks to the exits; an address only ever accessed directly and stored to in the loop lives in a register
+/// there, loaded in the preheader and stored at the exits.
+class LICM {
+public:
+	explicit LICM(Wrapper &env) : env(env) {}
+	void work();
+
+private:
+	Wrapper &env;
+};
+
+}// namespace IR
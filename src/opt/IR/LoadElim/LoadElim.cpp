@@ -0,0 +1,182 @@
+#include "LoadElim.h"
+#include "opt/IR/Analysis/Alias.h"
+#include "opt/IR/Analysis/DomTree.h"
+#include "opt/IR/Analysis/Expr.h"
+#include <algorithm>
+#include <map>
+#include <queue>
+#include <set>
+
+using namespace IR;
+
+namespace {
+
+constexpr int maxRegion = 64;   // blocks searched between a block and its immediate dominator
+constexpr int maxAvailable = 32;// values remembered at once
+
+/// @brief `value` is in memory at `pointer`
+struct Available {
+	Var *pointer;
+	Type *type;
+	Val *value;
+};
+
+class Forwarder {
+	Function *func;
+	AliasAnalysis aa;
+	CFG cfg;
+	DomTree dom;
+
+public:
+	Forwarder(Function *func, SideEffect const &effect, ModRef const &modRef)
+		: func(func), aa(func, effect, modRef), cfg(func), dom(cfg) {}
+	void work();
+
+private:
+	std::map<Val *, Val *> substitute;
+	std::set<Stmt *> removed;
+	std::map<BasicBlock *, std::vector<Available>> out;
+	std::map<Expr, Var *> table;// getelementptrs, so that an address computed from a forwarded pointer is found again
+	std::vector<std::vector<Expr>> scopes;
+
+	Val *find(Val *val);
+	Var *pointer_of(Var *pointer);
+	/// @brief what is still known at the start of `block`
+	std::vector<Available> available_in(BasicBlock *block);
+	void kill(std::vector<Available> &list, Stmt *stmt);
+	void visit(BasicBlock *block, std::vector<Available> &list);
+};
+
+}// namespace
+
+void LoadElim::work() {
+	SideEffect effect(env.get_module());
+	ModRef modRef(env.get_module());
+	for (auto func: env.get_module()->functions)
+		if (!func->blocks.empty())
+			Forwarder(func, effect, modRef).work();
+}
+
+void Forwarder::work() {
+	std::vector<std::pair<BasicBlock *, bool>> stack;
+	for (auto root: dom.roots)
+		stack.emplace_back(root, false);
+	while (!stack.empty()) {
+		auto [block, leave] = stack.back();
+		stack.pop_back();
+		if (leave) {
+			for (auto &expr: scopes.back())
+				table.erase(expr);
+			scopes.pop_back();
+			continue;
+		}
+		scopes.emplace_back();
+		stack.emplace_back(block, true);
+		auto list = available_in(block);
+		visit(block, list);
+		out[block] = std::move(list);
+		for (auto son: dom.children[block])
+			stack.emplace_back(son, false);
+	}
+
+	for (auto block: func->blocks) {
+		std::erase_if(block->stmts, [&](Stmt *stmt) { return removed.contains(stmt); });
+		auto rewrite = [&](Stmt *stmt) {
+			for (auto use: stmt->getUse())
+				if (auto to = find(use); to != use)
+					stmt->replaceUse(use, to);
+		};
+		for (auto [res, phi]: block->phis)
+			rewrite(phi);
+		for (auto stmt: block->stmts)
+			rewrite(stmt);
+	}
+}
+
+Val *Forwarder::find(Val *val) {
+	while (substitute.contains(val))
+		val = substitute[val];
+	return val;
+}
+
+Var *Forwarder::pointer_of(Var *pointer) {
+	auto var = dynamic_cast<Var *>(find(pointer));
+	return var ? var : pointer;
+}
+
+std::vector<Available> Forwarder::available_in(BasicBlock *block) {
+	auto parent = dom.idom[block];
+	if (!parent) return {};
+	auto list = out[parent];
+	// every path from the end of `parent` to `block` runs through the blocks reaching `block` without passing `parent`
+	std::set<BasicBlock *> region;
+	std::queue<BasicBlock *> q;
+	q.push(block);
+	while (!q.empty()) {
+		auto cur = q.front();
+		q.pop();
+		for (auto pred: cfg.predecessors[cur])
+			if (pred != parent && region.insert(pred).second) q.push(pred);
+		if (static_cast<int>(region.size()) > maxRegion) return {};
+	}
+	for (auto cur: region)
+		for (auto stmt: cur->stmts)
+			kill(list, stmt);
+	return list;
+}
+
+void Forwarder::kill(std::vector<Available> &list, Stmt *stmt) {
+	if (auto store = dynamic_cast<StoreStmt *>(stmt)) {
+		auto pointer = pointer_of(store->pointer);
+		std::erase_if(list, [&](Available const &a) { return aa.may_alias(a.pointer, a.type, pointer, store->value->type); });
+	}
+	else if (auto call = dynamic_cast<CallStmt *>(stmt))
+		std::erase_if(list, [&](Available const &a) { return aa.may_modify(call, a.pointer); });
+}
+
+void Forwarder::visit(BasicBlock *block, std::vector<Available> &list) {
+	auto remember = [&](Available a) {
+		list.push_back(a);
+		if (static_cast<int>(list.size()) > maxAvailable) list.erase(list.begin());
+	};
+	for (auto stmt: block->stmts) {
+		if (auto gep = dynamic_cast<GetElementPtrStmt *>(stmt)) {
+			auto expr = *expression_of(gep, [this](Val *val) { return find(val); });
+			if (auto it = table.find(expr); it != table.end()) {
+				substitute[gep->res] = it->second;
+				removed.insert(gep);
+			}
+			else {
+				table.emplace(expr, gep->res);
+				scopes.back().push_back(expr);
+			}
+		}
+		else if (auto load = dynamic_cast<LoadStmt *>(stmt)) {
+			auto pointer = pointer_of(load->pointer);
+			auto it = std::ranges::find_if(list, [&](Available const &a) {
+				return aa.alias(a.pointer, a.type, pointer, load->res->type) == AliasAnalysis::MustAlias;
+			});
+			if (it != list.end()) {
+				substitute[load->res] = find(it->value);
+				removed.insert(load);
+			}
+			else
+				remember({pointer, load->res->type, load->res});
+		}
+		else if (auto store = dynamic_cast<StoreStmt *>(stmt)) {
+			auto pointer = pointer_of(store->pointer);
+			// the value is already there
+			if (std::ranges::any_of(list, [&](Available const &a) {
+					return find(a.value) == find(store->value) &&
+						   aa.alias(a.pointer, a.type, pointer, store->value->type) == AliasAnalysis::MustAlias;
+				})) {
+				removed.insert(store);
+				continue;
+			}
+			kill(list, store);
+			remember({pointer, store->value->type, store->value});
+		}
+		else
+			kill(list, stmt);
+	}
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include "IR/Wrapper.h"
+
+namespace IR {
+
+/// @brief redundant load elimination and store to load forwarding.
+/// walking the dominator tree, a load takes the value last stored to or loaded from the same address, unless a store
+/// or a call that may alias it lies on some path in between. a store of the value already there is dropped.
+class LoadElim {
+public:
+	explicit LoadElim(Wrapper &env) : env(env) {}
+	void work();
+
+private:
+	Wrapper &env;
+};
+
+}// namespace IR
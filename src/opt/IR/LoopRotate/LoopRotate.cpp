@@ -0,0 +1,201 @@
+#include "LoopRotate.h"
+#include "IR/Cloner.h"
+#include "opt/IR/Analysis/DomTree.h"
+#include "opt/IR/Analysis/LoopInfo.h"
+#include "opt/IR/ConstFold/ConstFold.h"
+#include "opt/IR/LoopSimplify/LoopSimplify.h"
+#include <algorithm>
+#include <set>
+
+using namespace IR;
+
+namespace {
+
+constexpr int maxHeaderSize = 16;// stmts copied to the latch
+
+class Rotator {
+	Wrapper &env;
+	Function *func;
+	std::set<BasicBlock *> rotated;// headers of rotated loops
+
+public:
+	Rotator(Wrapper &env, Function *func) : env(env), func(func) {}
+	void work() {
+		// a rotation adds a block to every loop around the rotated one, so analyse again after each
+		bool changed = true;
+		while (changed) {
+			changed = false;
+			LoopSimplify(env).work(func);
+			CFG cfg(func);
+			LoopInfo info(cfg);
+			DomTree dom(cfg);
+			for (auto loop: info.inner_to_outer())
+				if (rotate(cfg, dom, loop)) {
+					changed = true;
+					break;
+				}
+		}
+	}
+
+private:
+	Var *new_like(Var *var, std::string const &prefix) {
+		if (auto ptr = dynamic_cast<PtrVar *>(var))
+			return env.create_annoy_ptr_var(ptr->objType, prefix);
+		return env.create_annoy_var(var->type, prefix);
+	}
+
+	/// @brief header H: phis, stmts, br c, B, X (B in the loop, X out of it) and a single latch L become
+	/// H: stmts on the values from the preheader, br c, B', X'
+	/// B': phis merging the values of H from H and H2, ...
+	/// L: ..., br H2
+	/// H2: stmts on the values from L, br c2, B', X'
+	/// X': phis merging the values of H from H and H2
+	bool rotate(CFG &cfg, DomTree &dom, Loop *loop) {
+		auto header = loop->header;
+		if (rotated.contains(header) || !loop->preheader || loop->latches.size() != 1 || loop->latches.front() == header) return false;
+		auto latch = loop->latches.front(), preheader = loop->preheader;
+		auto br = dynamic_cast<CondBrStmt *>(header->stmts.back());
+		if (!br) return false;
+		bool stay = loop->contains(br->trueBlock);
+		auto body = stay ? br->trueBlock : br->falseBlock, exit = stay ? br->falseBlock : br->trueBlock;
+		if (loop->contains(exit) || !loop->contains(body) || body == header) return false;
+		if (cfg.predecessors[body].size() != 1) return false;
+		// an exit shared with a break gets a block of its own, then only phis there may use the values of the header
+		bool shared = cfg.predecessors[exit].size() != 1;
+		if (header->stmts.size() > maxHeaderSize + 1) return false;
+		for (auto stmt: header->stmts)
+			if (dynamic_cast<AllocaStmt *>(stmt)) return false;
+
+		// values of the header and where they are used
+		std::vector<Var *> defs;
+		for (auto [res, phi]: header->phis)
+			defs.push_back(res);
+		for (auto stmt: header->stmts)
+			if (auto def = stmt->getDef()) defs.push_back(def);
+		std::set<Val *> defined(defs.begin(), defs.end());
+		// a use outside the loop has to see the value of the last test, so it must be below the exit
+		auto inside = [&](BasicBlock *block) { return loop->contains(block) && block != header; };
+		for (auto block: func->blocks) {
+			if (loop->contains(block)) continue;
+			for (auto [res, phi]: block->phis)
+				for (auto [from, val]: phi->branches)
+					if (defined.contains(val) && from != header && !inside(from) && (shared || !dom.dominates(exit, from))) return false;
+			for (auto stmt: block->stmts)
+				for (auto val: stmt->getUse())
+					if (defined.contains(val) && (shared || !dom.dominates(exit, block))) return false;
+		}
+		if (shared) {
+			auto split = env.create_annoy_block("loop_exit_");
+			split->stmts.push_back(env.createDirectBrStmt(exit));
+			for (auto [res, phi]: exit->phis)
+				if (auto p = phi->branches.find(header); p != phi->branches.end()) {
+					phi->branches[split] = p->second;
+					phi->branches.erase(p);
+				}
+			br = env.createCondBrStmt(br->cond, br->trueBlock == exit ? split : br->trueBlock, br->falseBlock == exit ? split : br->falseBlock);
+			header->stmts.back() = br;
+			func->blocks.insert(std::ranges::find(func->blocks, exit), split);
+			exit = split;
+		}
+
+		// the copy at the latch starts from the values of the current iteration, which the body sees through new phis
+		std::map<Val *, Val *> inBody;
+		Cloner atLatch(env, ".rot.");
+		for (auto def: defs)
+			inBody[def] = new_like(def, ".rot.");
+		for (auto [res, phi]: header->phis) {
+			auto val = phi->branches[latch];
+			atLatch.val[res] = defined.contains(val) ? inBody[val] : val;
+		}
+		auto copy = env.create_annoy_block(header->label + "_rot_");
+		for (auto stmt: header->stmts)
+			copy->stmts.push_back(atLatch.clone(stmt));
+
+		// uses in the body; the copy needs the body phis of the values it starts from
+		std::set<Var *> needBody, needExit;
+		auto need = [&](Val *val) {
+			auto p = std::ranges::find(defs, val);
+			if (p != defs.end()) needBody.insert(*p);
+			return inBody.contains(val) ? inBody[val] : val;
+		};
+		for (auto block: loop->blocks) {
+			if (block == header) continue;
+			for (auto [res, phi]: block->phis)
+				for (auto [from, val]: phi->branches)
+					if (from != header && defined.contains(val)) phi->branches[from] = need(val);
+			for (auto stmt: block->stmts)
+				for (auto val: stmt->getUse())
+					if (defined.contains(val)) stmt->replaceUse(val, need(val));
+		}
+		// the copy starts from the latch values
+		for (auto [res, phi]: header->phis)
+			need(phi->branches[latch]);
+		auto fromCopy = [&](Val *val) { return atLatch(val); };
+		for (auto [res, phi]: body->phis)
+			phi->branches[copy] = fromCopy(phi->branches[header]);
+
+		// uses below the exit
+		std::map<Val *, Val *> inExit;
+		for (auto def: defs)
+			inExit[def] = new_like(def, ".rot.");
+		for (auto [res, phi]: exit->phis)
+			phi->branches[copy] = fromCopy(phi->branches[header]);
+		for (auto block: func->blocks) {
+			if (loop->contains(block)) continue;
+			for (auto [res, phi]: block->phis)
+				for (auto [from, val]: phi->branches) {
+					if (!defined.contains(val) || from == header) continue;
+					if (inside(from)) {
+						phi->branches[from] = need(val);
+						continue;
+					}
+					needExit.insert(dynamic_cast<Var *>(val));
+					phi->branches[from] = inExit[val];
+				}
+			for (auto stmt: block->stmts)
+				for (auto val: stmt->getUse())
+					if (defined.contains(val)) {
+						needExit.insert(dynamic_cast<Var *>(val));
+						stmt->replaceUse(val, inExit[val]);
+					}
+		}
+		for (auto def: needExit) {
+			auto res = dynamic_cast<Var *>(inExit[def]);
+			exit->phis[res] = env.createPhiStmt(res, std::map<BasicBlock *, Val *>{{header, def}, {copy, fromCopy(def)}});
+		}
+		for (auto def: needBody) {
+			auto res = dynamic_cast<Var *>(inBody[def]);
+			body->phis[res] = env.createPhiStmt(res, std::map<BasicBlock *, Val *>{{header, def}, {copy, fromCopy(def)}});
+		}
+
+		// the latch goes to the copy instead of the header, which keeps the value from the preheader only
+		auto &term = latch->stmts.back();
+		if (auto cbr = dynamic_cast<CondBrStmt *>(term))
+			term = env.createCondBrStmt(cbr->cond, cbr->trueBlock == header ? copy : cbr->trueBlock, cbr->falseBlock == header ? copy : cbr->falseBlock);
+		else
+			term = env.createDirectBrStmt(copy);
+		func->blocks.insert(std::next(std::ranges::find(func->blocks, latch)), copy);
+		// the header runs once now, its phis are the values from the preheader
+		std::map<Val *, Val *> entry;
+		for (auto [res, phi]: header->phis)
+			entry[res] = phi->branches[preheader];
+		header->phis.clear();
+		for (auto block: func->blocks) {
+			for (auto [res, phi]: block->phis)
+				for (auto [from, to]: entry) phi->replaceUse(from, to);
+			for (auto stmt: block->stmts)
+				for (auto [from, to]: entry) stmt->replaceUse(from, to);
+		}
+		rotated.insert(body);
+		return true;
+	}
+};
+
+}// namespace
+
+void LoopRotate::work() {
+	for (auto func: env.get_module()->functions)
+		if (!func->blocks.empty())
+			Rotator(env, func).work();
+	ConstFold(env).work();
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include "IR/Wrapper.h"
+
+namespace IR {
+
+/// @brief turn loops tested at the header into guarded do-while loops.
+/// the header stays in front of the loop as its guard and a copy of it ends the latch, so an iteration takes one
+/// conditional branch instead of a branch and a jump back.
+class LoopRotate {
+public:
+	explicit LoopRotate(Wrapper &env) : env(env) {}
+	void work();
+
+private:
+	Wrapper &env;
+};
+
+}// namespace IR
@@ -0,0 +1,88 @@
+#include "LoopSimplify.h"
+#include "opt/IR/Analysis/LoopInfo.h"
+#include <algorithm>
+#include <set>
+
+using namespace IR;
+
+namespace {
+
+void retarget(Wrapper &env, BasicBlock *from, BasicBlock *oldTo, BasicBlock *newTo) {
+	// terminators may be shared between blocks, replace instead of modifying
+	auto &term = from->stmts.back();
+	if (auto br = dynamic_cast<CondBrStmt *>(term))
+		term = env.createCondBrStmt(br->cond, br->trueBlock == oldTo ? newTo : br->trueBlock, br->falseBlock == oldTo ? newTo : br->falseBlock);
+	else if (dynamic_cast<DirectBrStmt *>(term))
+		term = env.createDirectBrStmt(newTo);
+}
+
+/// @brief insert a new block on the edges from `preds` to `to`, merging their phi values in it
+BasicBlock *split_predecessors(Wrapper &env, Function *func, BasicBlock *to, std::vector<BasicBlock *> const &preds, std::string const &prefix) {
+	auto block = env.create_annoy_block(prefix);
+	for (auto [res, phi]: to->phis) {
+		std::map<BasicBlock *, Val *> branches;
+		for (auto pred: preds)
+			if (auto p = phi->branches.find(pred); p != phi->branches.end()) {
+				branches.insert(*p);
+				phi->branches.erase(p);
+			}
+		if (branches.empty()) continue;
+		Val *val = branches.begin()->second;
+		if (std::ranges::any_of(branches, [val](auto const &p) { return p.second != val; })) {
+			auto var = env.create_annoy_var(res->type, "." + prefix);
+			block->phis[var] = env.createPhiStmt(var, branches);
+			val = var;
+		}
+		phi->branches[block] = val;
+	}
+	block->stmts.push_back(env.createDirectBrStmt(to));
+	for (auto pred: preds)
+		retarget(env, pred, to, block);
+	func->blocks.insert(std::ranges::find(func->blocks, to), block);
+	return block;
+}
+
+}// namespace
+
+void LoopSimplify::work() {
+	for (auto func: env.get_module()->functions)
+		if (!func->blocks.empty())
+			work(func);
+}
+
+bool LoopSimplify::work(Function *func) {
+	bool changed = false;
+	// every split changes the loop forest, so start over after each one
+	for (bool again = true; again;) {
+		again = false;
+		CFG cfg(func);
+		LoopInfo info(cfg);
+		std::set<BasicBlock *> reachable(cfg.rpo.begin(), cfg.rpo.end());
+		for (auto loop: info.inner_to_outer()) {
+			if (!loop->preheader) {
+				std::vector<BasicBlock *> outside;
+				for (auto pred: cfg.predecessors[loop->header])
+					if (!loop->contains(pred) && reachable.contains(pred))
+						outside.push_back(pred);
+				if (!outside.empty()) {
+					split_predecessors(env, func, loop->header, outside, "loop_ph_");
+					again = true;
+					break;
+				}
+			}
+			for (auto exit: loop->exits) {
+				std::vector<BasicBlock *> inside;
+				for (auto pred: cfg.predecessors[exit])
+					if (loop->contains(pred)) inside.push_back(pred);
+				if (inside.size() != cfg.predecessors[exit].size()) {
+					split_predecessors(env, func, exit, inside, "loop_exit_");
+					again = true;
+					break;
+				}
+			}
+			if (again) break;
+		}
+		changed |= again;
+	}
+	return changed;
+}
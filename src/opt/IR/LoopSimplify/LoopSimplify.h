@@ -0,0 +1,19 @@
+#pragma once
+#include "IR/Wrapper.h"
+
+namespace IR {
+
+/// @brief put loops into canonical shape: every loop has a preheader and exit blocks entered only from inside the loop.
+/// passes moving code out of or below loops run this first; blocks left empty are folded back by ConstFold.
+class LoopSimplify {
+public:
+	explicit LoopSimplify(Wrapper &env) : env(env) {}
+	void work();
+	/// @return whether blocks were added
+	bool work(Function *func);
+
+private:
+	Wrapper &env;
+};
+
+}// namespace IR
@@ -0,0 +1,395 @@
+#include "LoopUnroll.h"
+#include "IR/Cloner.h"
+#include "opt/IR/Analysis/Induction.h"
+#include "opt/IR/ConstFold/ConstFold.h"
+#include "opt/IR/LoopSimplify/LoopSimplify.h"
+#include <algorithm>
+#include <optional>
+#include <set>
+
+using namespace IR;
+
+namespace {
+
+/// @brief how far loops may grow, counted in stmts
+struct Budget {
+	int fullTrip = 0;   // largest trip count unrolled completely
+	int fullSize = 0;   // size of a completely unrolled loop
+	int factor = 1;     // copies of the body in a partially unrolled loop
+	int partialSize = 0;// size of the body of a partially unrolled loop
+};
+
+Budget budget_of(int level) {
+	if (level <= 0) return {};
+	if (level == 1) return {8, 64, 1, 0};
+	if (level == 2) return {16, 128, 4, 64};
+	return {32, 256, 8, 128};
+}
+
+/// @brief the only way out of a loop: `exiting` stays in the loop while `x cmd bound` with `x = iv + constant`
+struct ExitTest {
+	BasicBlock *exiting = nullptr, *inside = nullptr, *exit = nullptr;
+	IcmpStmt *icmp = nullptr;
+	InductionVar *iv = nullptr;
+	int constant = 0;
+	std::string cmd;
+	Val *bound = nullptr;
+};
+
+class Unroller {
+	Wrapper &env;
+	Budget const &budget;
+	Function *func;
+	std::set<BasicBlock *> done;// headers of the loops made by partial unrolling
+	std::map<Val *, std::vector<Stmt *>> users;
+
+public:
+	Unroller(Wrapper &env, Budget const &budget, Function *func) : env(env), budget(budget), func(func) {}
+	void work() {
+		// unrolling an inner loop completely may leave its parent innermost, so analyse again after every change
+		bool changed = true;
+		while (changed) {
+			changed = false;
+			LoopSimplify(env).work(func);
+			CFG cfg(func);
+			LoopInfo info(cfg);
+			for (auto loop: info.inner_to_outer())
+				if (loop->children.empty() && !done.contains(loop->header) && unroll(cfg, loop)) {
+					changed = true;
+					break;
+				}
+		}
+	}
+
+private:
+	void collect_users() {
+		users.clear();
+		for (auto block: func->blocks) {
+			for (auto [res, phi]: block->phis)
+				for (auto val: phi->getUse())
+					users[val].push_back(phi);
+			for (auto stmt: block->stmts)
+				for (auto val: stmt->getUse())
+					users[val].push_back(stmt);
+		}
+	}
+
+	std::optional<ExitTest> exit_test(CFG &cfg, Loop *loop, Induction &ind) {
+		ExitTest test;
+		for (auto block: loop->blocks)
+			for (auto succ: cfg.successors[block])
+				if (!loop->contains(succ)) {
+					if (test.exiting) return std::nullopt;
+					test.exiting = block, test.exit = succ;
+				}
+		if (!test.exiting || (test.exiting != loop->header && test.exiting != loop->latches.front())) return std::nullopt;
+		auto br = dynamic_cast<CondBrStmt *>(test.exiting->stmts.back());
+		if (!br || br->trueBlock == br->falseBlock) return std::nullopt;
+		bool stay = br->trueBlock != test.exit;
+		test.inside = stay ? br->trueBlock : br->falseBlock;
+		for (auto stmt: test.exiting->stmts)
+			if (stmt->getDef() && stmt->getDef() == br->cond) test.icmp = dynamic_cast<IcmpStmt *>(stmt);
+		if (!test.icmp) return std::nullopt;
+		for (int side = 0; side < 2; ++side) {
+			auto x = side ? test.icmp->rhs : test.icmp->lhs, bound = side ? test.icmp->lhs : test.icmp->rhs;
+			auto affine = ind.affine_of(x);
+			if (!affine || affine->scale != 1 || affine->offset || !ind.invariant(bound)) continue;
+			if (affine->iv->increments.size() != 1) continue;
+			test.iv = affine->iv;
+			test.constant = affine->constant;
+			test.bound = bound;
+			test.cmd = side ? swapped(test.icmp->cmd) : test.icmp->cmd;
+			if (!stay) test.cmd = inverted(test.cmd);
+			return test;
+		}
+		return std::nullopt;
+	}
+
+	/// @return the index of the iteration leaving the loop, if it is known and not too large
+	std::optional<int> trip_count(ExitTest const &test) {
+		auto start = dynamic_cast<LiteralInt *>(test.iv->start), bound = dynamic_cast<LiteralInt *>(test.bound);
+		if (!start || !bound) return std::nullopt;
+		int x = calc_arithmetic("add", start->value, test.constant);
+		for (int k = 0; k <= budget.fullTrip; ++k) {
+			if (!calc_icmp(test.cmd, x, bound->value)) return k;
+			x = calc_arithmetic("add", x, test.iv->step);
+		}
+		return std::nullopt;
+	}
+
+	bool unroll(CFG &cfg, Loop *loop) {
+		if (!loop->preheader || loop->latches.size() != 1) return false;
+		std::vector<BasicBlock *> blocks;
+		for (auto block: cfg.rpo)
+			if (loop->contains(block)) blocks.push_back(block);
+		int size = 0;
+		bool calls = false;
+		for (auto block: blocks) {
+			size += static_cast<int>(block->phis.size() + block->stmts.size());
+			for (auto stmt: block->stmts) {
+				if (dynamic_cast<AllocaStmt *>(stmt)) return false;
+				calls |= dynamic_cast<CallStmt *>(stmt) != nullptr;
+			}
+		}
+		Induction ind(cfg, loop);
+		auto test = exit_test(cfg, loop, ind);
+		if (!test) return false;
+		collect_users();
+		// a header phi may become a literal, which cannot stand where an address is expected
+		for (auto [res, phi]: loop->header->phis) {
+			if (std::ranges::all_of(phi->getUse(), [](Val *val) { return dynamic_cast<Var *>(val); })) continue;
+			for (auto user: users[res]) {
+				auto load = dynamic_cast<LoadStmt *>(user);
+				auto store = dynamic_cast<StoreStmt *>(user);
+				auto gep = dynamic_cast<GetElementPtrStmt *>(user);
+				if ((load && load->pointer == res) || (store && store->pointer == res) || (gep && gep->pointer == res))
+					return false;
+			}
+		}
+
+		auto trip = trip_count(*test);
+		if (trip && size * (*trip + 1) <= budget.fullSize) {
+			unroll_fully(loop, blocks, *test, *trip);
+			return true;
+		}
+		// the main loop leaves at its header and the original loop runs that header again
+		if (calls || test->exiting != loop->header) return false;
+		for (auto stmt: loop->header->stmts)
+			if (dynamic_cast<StoreStmt *>(stmt)) return false;
+		int step = test->iv->step;
+		if (!((step > 0 && (test->cmd == "slt" || test->cmd == "sle")) || (step < 0 && (test->cmd == "sgt" || test->cmd == "sge"))))
+			return false;
+		int factor = budget.factor;
+		while (factor > 1 && size * factor > budget.partialSize) factor /= 2;
+		if (factor < 2 || step > (1 << 20) || step < -(1 << 20) || (trip && *trip < 2 * factor)) return false;
+		unroll_partially(loop, blocks, *test, factor);
+		return true;
+	}
+
+	/// @brief the exit test is only needed where the loop may be left
+	std::set<Stmt *> removable_test(ExitTest const &test) {
+		auto &user = users[test.icmp->res];
+		if (user.size() == 1 && user.front() == test.exiting->stmts.back()) return {test.icmp};
+		return {};
+	}
+
+	/// @brief fill the blocks of `copy` with the stmts of `blocks` but the terminators.
+	/// header phis must be mapped already; an increment of an induction variable is computed from `base` directly,
+	/// so the copies do not form a chain of additions.
+	void clone(Loop *loop, std::vector<BasicBlock *> const &blocks, Cloner &copy, int k, std::set<Stmt *> const &skip, std::map<PhiStmt *, Val *> const &base,
+			   std::map<Stmt *, InductionVar *> const &incOf) {
+		for (auto block: blocks) {
+			if (block != loop->header)
+				for (auto [res, phi]: block->phis)
+					copy.fresh(res);
+			for (auto stmt: block->stmts)
+				if (auto def = stmt->getDef())
+					copy.fresh(def);
+		}
+		for (auto block: blocks) {
+			auto to = copy.block[block];
+			if (block != loop->header)
+				for (auto [res, phi]: block->phis) {
+					auto res2 = copy(res);
+					auto phi2 = env.createPhiStmt(res2);
+					for (auto [from, val]: phi->branches)
+						if (copy.block.contains(from))
+							phi2->branches[copy.block[from]] = copy(val);
+					to->phis[res2] = phi2;
+				}
+			for (auto stmt: block->stmts) {
+				if (skip.contains(stmt) || stmt == block->stmts.back()) continue;
+				if (auto p = incOf.find(stmt); p != incOf.end()) {
+					auto iv = p->second;
+					auto step = env.get_literal_int(calc_arithmetic("mul", k + 1, iv->step));
+					to->stmts.push_back(env.createArithmeticStmt("add", copy(stmt->getDef()), base.at(iv->phi), step));
+				}
+				else
+					to->stmts.push_back(copy.clone(stmt));
+			}
+		}
+	}
+
+	/// @brief a terminator of a block other than the exiting one, the back edge goes to `next`
+	Stmt *clone_terminator(BasicBlock *block, Loop *loop, Cloner &copy, BasicBlock *next) {
+		auto target = [&](BasicBlock *to) { return to == loop->header ? next : copy.block.at(to); };
+		auto back = block->stmts.back();
+		if (auto direct = dynamic_cast<DirectBrStmt *>(back))
+			return env.createDirectBrStmt(target(direct->block));
+		auto cond = dynamic_cast<CondBrStmt *>(back);
+		if (!cond) throw std::runtime_error("LoopUnroll: unexpected terminator " + back->to_string());
+		return env.createCondBrStmt(copy(cond->cond), target(cond->trueBlock), target(cond->falseBlock));
+	}
+
+	static std::map<Stmt *, InductionVar *> increments_of(ExitTest const &test) {
+		std::map<Stmt *, InductionVar *> incOf;
+		// only the tested induction variable is known to be canonical here
+		incOf[test.iv->increments.front()] = test.iv;
+		return incOf;
+	}
+
+	/// @brief iterations 0..trip one after another, the last one leaves at the exiting block
+	void unroll_fully(Loop *loop, std::vector<BasicBlock *> const &blocks, ExitTest const &test, int trip) {
+		auto header = loop->header, latch = loop->latches.front(), preheader = loop->preheader;
+		// blocks run by the last iteration, which stops at the exiting block
+		std::vector<BasicBlock *> last;
+		{
+			std::set<BasicBlock *> seen{header};
+			std::vector<BasicBlock *> stack{header};
+			while (!stack.empty()) {
+				auto block = stack.back();
+				stack.pop_back();
+				if (block == test.exiting) continue;
+				for (auto succ: successors_of(block))
+					if (loop->contains(succ) && !seen.contains(succ)) seen.insert(succ), stack.push_back(succ);
+			}
+			for (auto block: blocks)
+				if (seen.contains(block)) last.push_back(block);
+		}
+		auto skip = removable_test(test);
+		auto incOf = increments_of(test);
+		std::map<PhiStmt *, Val *> base{{test.iv->phi, test.iv->start}};
+
+		std::vector<Cloner> copies(trip + 1, Cloner(env, ".unroll."));
+		for (int k = 0; k <= trip; ++k)
+			for (auto block: k == trip ? last : blocks)
+				copies[k].block[block] = env.create_annoy_block(block->label + "_u");
+		for (int k = 0; k <= trip; ++k) {
+			auto &copy = copies[k];
+			for (auto [res, phi]: header->phis)
+				copy.val[res] = k == 0 ? phi->branches[preheader] : copies[k - 1](phi->branches[latch]);
+			auto &part = k == trip ? last : blocks;
+			clone(loop, part, copy, k, skip, base, incOf);
+			auto next = k < trip ? copies[k + 1].block[header] : nullptr;
+			for (auto block: part) {
+				if (block == test.exiting) {
+					auto to = k < trip ? (test.inside == header ? next : copy.block[test.inside]) : test.exit;
+					copy.block[block]->stmts.push_back(env.createDirectBrStmt(to));
+				}
+				else
+					copy.block[block]->stmts.push_back(clone_terminator(block, loop, copy, next));
+			}
+		}
+
+		auto &final = copies[trip];
+		for (auto [res, phi]: test.exit->phis) {
+			auto val = phi->branches[test.exiting];
+			phi->branches.erase(test.exiting);
+			phi->branches[final.block[test.exiting]] = final(val);
+		}
+		preheader->stmts.back() = env.createDirectBrStmt(copies[0].block[header]);
+		for (auto block: func->blocks) {
+			if (loop->contains(block)) continue;
+			for (auto [res, phi]: block->phis)
+				for (auto val: phi->getUse())
+					phi->replaceUse(val, final(val));
+			for (auto stmt: block->stmts)
+				for (auto val: stmt->getUse())
+					stmt->replaceUse(val, final(val));
+		}
+
+		std::vector<BasicBlock *> added;
+		for (int k = 0; k <= trip; ++k)
+			for (auto block: k == trip ? last : blocks)
+				added.push_back(copies[k].block[block]);
+		replace_blocks(loop, added, true);
+	}
+
+	/// @brief a main loop running `factor` iterations per test while all of them are known to stay in the loop,
+	/// followed by the original loop for the rest
+	void unroll_partially(Loop *loop, std::vector<BasicBlock *> const &blocks, ExitTest const &test, int factor) {
+		auto header = loop->header, latch = loop->latches.front(), preheader = loop->preheader;
+		auto skip = removable_test(test);
+		auto incOf = increments_of(test);
+
+		// x + (factor - 1) * step stays in the loop iff x stays below lim, if lim does not wrap around
+		int span = (factor - 1) * test.iv->step;
+		auto guard = std::prev(preheader->stmts.end());
+		Val *lim, *ok;
+		if (auto num = dynamic_cast<LiteralInt *>(test.bound)) {
+			int value = calc_arithmetic("sub", num->value, span);
+			lim = env.get_literal_int(value);
+			ok = env.get_literal_bool(span > 0 ? value < num->value : value > num->value);
+		}
+		else {
+			auto limVar = env.create_annoy_var(env.intType, ".unroll.lim.");
+			auto okVar = env.create_annoy_var(env.boolType, ".unroll.ok.");
+			preheader->stmts.insert(guard, env.createArithmeticStmt("sub", limVar, test.bound, env.get_literal_int(span)));
+			preheader->stmts.insert(guard, env.createIcmpStmt(span > 0 ? "slt" : "sgt", okVar, limVar, test.bound));
+			lim = limVar, ok = okVar;
+		}
+
+		std::vector<Cloner> copies(factor, Cloner(env, ".unroll."));
+		for (auto &copy: copies)
+			for (auto block: blocks)
+				copy.block[block] = env.create_annoy_block(block->label + "_u");
+		auto mainHeader = copies[0].block[header];
+		std::map<PhiStmt *, Val *> base;
+		for (auto [res, phi]: header->phis) {
+			auto res2 = copies[0].fresh(res);
+			if (phi == test.iv->phi) base[phi] = res2;
+		}
+		for (int k = 0; k < factor; ++k) {
+			auto &copy = copies[k];
+			if (k > 0)
+				for (auto [res, phi]: header->phis)
+					copy.val[res] = copies[k - 1](phi->branches[latch]);
+			clone(loop, blocks, copy, k, skip, base, incOf);
+			auto next = copies[(k + 1) % factor].block[header];
+			for (auto block: blocks) {
+				if (block != test.exiting) {
+					copy.block[block]->stmts.push_back(clone_terminator(block, loop, copy, next));
+					continue;
+				}
+				auto inside = test.inside == header ? next : copy.block[test.inside];
+				if (k > 0) {
+					copy.block[block]->stmts.push_back(env.createDirectBrStmt(inside));
+					continue;
+				}
+				auto icmp = test.icmp;
+				auto cond = env.create_annoy_var(env.boolType, ".unroll.cond.");
+				auto lhs = icmp->lhs == test.bound ? lim : copy(icmp->lhs), rhs = icmp->rhs == test.bound ? lim : copy(icmp->rhs);
+				copy.block[block]->stmts.push_back(env.createIcmpStmt(icmp->cmd, cond, lhs, rhs));
+				auto br = dynamic_cast<CondBrStmt *>(block->stmts.back());
+				bool stay = br->trueBlock == test.inside;
+				copy.block[block]->stmts.push_back(env.createCondBrStmt(cond, stay ? inside : header, stay ? header : inside));
+			}
+		}
+		for (auto [res, phi]: header->phis) {
+			auto res2 = copies[0](res);
+			auto phi2 = env.createPhiStmt(res2);
+			phi2->branches[preheader] = phi->branches[preheader];
+			phi2->branches[copies[factor - 1].block[latch]] = copies[factor - 1](phi->branches[latch]);
+			mainHeader->phis[res2] = phi2;
+			phi->branches[mainHeader] = res2;
+		}
+		preheader->stmts.back() = env.createCondBrStmt(ok, mainHeader, header);
+
+		std::vector<BasicBlock *> added;
+		for (auto &copy: copies)
+			for (auto block: blocks)
+				added.push_back(copy.block[block]);
+		replace_blocks(loop, added, false);
+		done.insert(header);
+		done.insert(mainHeader);
+	}
+
+	/// @brief put `added` where the loop starts, removing the loop if asked
+	void replace_blocks(Loop *loop, std::vector<BasicBlock *> const &added, bool remove) {
+		auto p = std::ranges::find(func->blocks, loop->header);
+		p = func->blocks.insert(p, added.begin(), added.end());
+		if (remove)
+			std::erase_if(func->blocks, [&](BasicBlock *block) { return loop->contains(block); });
+	}
+};
+
+}// namespace
+
+void LoopUnroll::work() {
+	auto budget = budget_of(level);
+	if (budget.fullTrip == 0) return;
+	for (auto func: env.get_module()->functions)
+		if (!func->blocks.empty())
+			Unroller(env, budget, func).work();
+	ConstFold(env).work();
+}
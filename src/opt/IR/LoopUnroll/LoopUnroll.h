@@ -0,0 +1,20 @@
+#pragma once
+#include "IR/Wrapper.h"
+
+namespace IR {
+
+/// @brief loop unrolling of innermost counted loops.
+/// a loop with a small constant trip count is replaced by one copy of its body per iteration, the exit tests are left
+/// to ConstFold; a larger one runs a main loop of several bodies with one test each, and the original loop handles the
+/// remaining iterations. how much code may grow is decided by the optimization level.
+class LoopUnroll {
+public:
+	LoopUnroll(Wrapper &env, int level) : env(env), level(level) {}
+	void work();
+
+private:
+	Wrapper &env;
+	int level;
+};
+
+}// namespace IR
@@ -0,0 +1,173 @@
+#include "LoopUnswitch.h"
+#include "IR/Cloner.h"
+#include "opt/IR/Analysis/LoopInfo.h"
+#include "opt/IR/ConstFold/ConstFold.h"
+#include "opt/IR/LoopSimplify/LoopSimplify.h"
+#include <algorithm>
+#include <set>
+
+using namespace IR;
+
+namespace {
+
+constexpr int maxLoopSize = 64;// stmts of a loop to be copied
+constexpr int maxGrowth = 256; // stmts added to a function
+
+class Unswitcher {
+	Wrapper &env;
+	Function *func;
+	int budget = maxGrowth;
+
+public:
+	Unswitcher(Wrapper &env, Function *func) : env(env), func(func) {}
+	void work() {
+		// a copy changes the loop forest, so analyse again after each one
+		bool changed = true;
+		while (changed) {
+			changed = false;
+			drop_unreachable();
+			LoopSimplify(env).work(func);
+			CFG cfg(func);
+			LoopInfo info(cfg);
+			for (auto loop: info.inner_to_outer())
+				if (unswitch(cfg, loop)) {
+					changed = true;
+					break;
+				}
+		}
+	}
+
+private:
+	/// @brief the side of a branch left by unswitching is not reached anymore, and its blocks would count as predecessors
+	void drop_unreachable() {
+		CFG cfg(func);
+		std::set<BasicBlock *> reachable(cfg.rpo.begin(), cfg.rpo.end());
+		if (reachable.size() == func->blocks.size()) return;
+		std::erase_if(func->blocks, [&](BasicBlock *block) { return !reachable.contains(block); });
+		for (auto block: func->blocks)
+			for (auto [res, phi]: block->phis)
+				std::erase_if(phi->branches, [&](auto const &branch) { return !reachable.contains(branch.first); });
+	}
+
+	/// @brief L with a branch br c, T, F on c from outside becomes
+	/// preheader: br c, L, L'
+	/// L: the branch is br T; L': the branch is br F'
+	/// the exits merge the values of L and L' used below the loop
+	bool unswitch(CFG &cfg, Loop *loop) {
+		if (!loop->preheader) return false;
+		std::vector<BasicBlock *> blocks;// in the order of the function, which the copy keeps
+		int size = 0;
+		for (auto block: func->blocks)
+			if (loop->contains(block)) {
+				blocks.push_back(block);
+				size += static_cast<int>(block->phis.size() + block->stmts.size());
+			}
+		if (size > maxLoopSize || size > budget) return false;
+
+		std::set<Val *> defined;
+		for (auto block: blocks) {
+			for (auto [res, phi]: block->phis)
+				defined.insert(res);
+			for (auto stmt: block->stmts)
+				if (auto def = stmt->getDef()) defined.insert(def);
+		}
+		BasicBlock *where = nullptr;
+		CondBrStmt *br = nullptr;
+		for (auto block: cfg.rpo) {
+			if (!loop->contains(block)) continue;
+			auto cbr = dynamic_cast<CondBrStmt *>(block->stmts.back());
+			if (cbr && cbr->trueBlock != cbr->falseBlock && dynamic_cast<Var *>(cbr->cond) && !defined.contains(cbr->cond)) {
+				where = block, br = cbr;
+				break;
+			}
+		}
+		if (!br) return false;
+
+		// a value of the loop used below it has to be merged from both copies, at an exit dominating the use
+		std::set<Var *> usedOutside;
+		for (auto block: func->blocks) {
+			if (loop->contains(block)) continue;
+			for (auto [res, phi]: block->phis)
+				for (auto [from, val]: phi->branches)
+					if (defined.contains(val) && !loop->contains(from)) usedOutside.insert(dynamic_cast<Var *>(val));
+			for (auto stmt: block->stmts)
+				for (auto val: stmt->getUse())
+					if (defined.contains(val)) usedOutside.insert(dynamic_cast<Var *>(val));
+		}
+		if (!usedOutside.empty() && loop->exits.size() != 1) return false;
+		for (auto exit: loop->exits)
+			for (auto pred: cfg.predecessors[exit])
+				if (!loop->contains(pred)) return false;
+
+		Cloner copy(env, ".unswitch.");
+		for (auto block: blocks) {
+			copy.block[block] = env.create_annoy_block(block->label + "_us_");
+			for (auto [res, phi]: block->phis)
+				copy.fresh(res);
+			for (auto stmt: block->stmts)
+				if (auto def = stmt->getDef()) copy.fresh(def);
+		}
+		for (auto block: blocks) {
+			auto to = copy(block);
+			for (auto [res, phi]: block->phis)
+				to->phis[copy(res)] = dynamic_cast<PhiStmt *>(copy.clone(phi));
+			for (auto stmt: block->stmts)
+				to->stmts.push_back(copy.clone(stmt));
+		}
+		for (auto exit: loop->exits)
+			for (auto [res, phi]: exit->phis) {
+				std::map<BasicBlock *, Val *> added;
+				for (auto [from, val]: phi->branches)
+					added[copy(from)] = copy(val);
+				phi->branches.merge(added);
+			}
+		if (!usedOutside.empty()) {
+			auto exit = loop->exits.front();
+			Cloner merge(env, ".unswitch.");
+			std::map<Var *, PhiStmt *> phis;
+			for (auto val: usedOutside) {
+				auto res = merge.fresh(val);
+				phis[res] = env.createPhiStmt(res);
+				for (auto pred: cfg.predecessors[exit]) {
+					phis[res]->branches[pred] = val;
+					phis[res]->branches[copy(pred)] = copy(val);
+				}
+			}
+			for (auto block: func->blocks) {
+				if (loop->contains(block)) continue;
+				for (auto [res, phi]: block->phis)
+					for (auto &[from, val]: phi->branches)
+						if (!loop->contains(from)) val = merge(val);
+				for (auto stmt: block->stmts)
+					for (auto [from, to]: merge.val)
+						stmt->replaceUse(from, to);
+			}
+			exit->phis.merge(phis);
+		}
+
+		// each copy keeps one side of the branch, the preheader picks the copy
+		auto keep = [&](BasicBlock *block, BasicBlock *to, BasicBlock *left) {
+			block->stmts.back() = env.createDirectBrStmt(to);
+			for (auto [res, phi]: left->phis)
+				phi->branches.erase(block);
+		};
+		keep(copy(where), copy(br->falseBlock), copy(br->trueBlock));
+		keep(where, br->trueBlock, br->falseBlock);
+		loop->preheader->stmts.back() = env.createCondBrStmt(br->cond, loop->header, copy(loop->header));
+		std::vector<BasicBlock *> copied;
+		for (auto block: blocks)
+			copied.push_back(copy(block));
+		func->blocks.insert(std::next(std::ranges::find(func->blocks, blocks.back())), copied.begin(), copied.end());
+		budget -= size;
+		return true;
+	}
+};
+
+}// namespace
+
+void LoopUnswitch::work() {
+	for (auto func: env.get_module()->functions)
+		if (!func->blocks.empty())
+			Unswitcher(env, func).work();
+	ConstFold(env).work();
+}
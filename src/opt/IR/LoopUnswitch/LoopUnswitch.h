@@ -0,0 +1,18 @@
+#pragma once
+#include "IR/Wrapper.h"
+
+namespace IR {
+
+/// @brief loop unswitching on loop invariant conditions.
+/// a loop branching on a value defined outside of it is copied, the preheader picks the copy by that value, and in
+/// each copy the branch becomes a jump to its side. loops and the total growth of a function are bounded in size.
+class LoopUnswitch {
+public:
+	explicit LoopUnswitch(Wrapper &env) : env(env) {}
+	void work();
+
+private:
+	Wrapper &env;
+};
+
+}// namespace IR
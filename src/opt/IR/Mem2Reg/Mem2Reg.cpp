@@ -68,6 +68,7 @@ private:
 		// LocalVar: not remember, not remove
 		// PtrVar(non-alloca): not remember, not remove
 		// StringLiteralVar: not remember, not remove // should not be here
+		change_ptr(node->pointer);
 		auto is_alloca = allocaVars.contains(dynamic_cast<PtrVar *>(node->pointer));
 		change(node->value);
 		if (is_alloca) {
@@ -77,6 +78,7 @@ private:
 		add_stmt(node);
 	}
 	void visitLoadStmt(IR::LoadStmt *node) override {
+		change_ptr(node->pointer);
 		if (auto p = def.find(dynamic_cast<PtrVar *>(node->pointer)); p != def.end())
 			substitute[node->res] = p->second;
 		else
@@ -92,6 +94,12 @@ private:
 		change(node->rhs);
 		add_stmt(node);
 	}
+	void visitSelectStmt(SelectStmt *node) override {
+		change(node->cond);
+		change(node->trueVal);
+		change(node->falseVal);
+		add_stmt(node);
+	}
 	void visitRetStmt(RetStmt *node) override {
 		change(node->value);
 		add_stmt(node);
@@ -0,0 +1,319 @@
+#include "PRE.h"
+#include "opt/IR/Analysis/CFG.h"
+#include "opt/IR/Analysis/Expr.h"
+#include "opt/IR/Mem2Reg/Mem2Reg.h"
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <queue>
+#include <ranges>
+#include <set>
+
+using namespace IR;
+
+namespace {
+
+struct BitSet {
+	size_t n = 0;
+	std::vector<uint64_t> bits;
+
+	explicit BitSet(size_t n = 0, bool full = false) : n(n), bits((n + 63) / 64, full ? ~0ull : 0ull) { trim(); }
+	[[nodiscard]] bool test(size_t i) const { return bits[i >> 6] >> (i & 63) & 1; }
+	void set(size_t i) { bits[i >> 6] |= 1ull << (i & 63); }
+	void trim() {
+		if (n & 63) bits.back() &= (1ull << (n & 63)) - 1;
+	}
+	BitSet &operator&=(BitSet const &o) {
+		for (size_t i = 0; i < bits.size(); ++i) bits[i] &= o.bits[i];
+		return *this;
+	}
+	BitSet &operator|=(BitSet const &o) {
+		for (size_t i = 0; i < bits.size(); ++i) bits[i] |= o.bits[i];
+		return *this;
+	}
+	BitSet &operator-=(BitSet const &o) {
+		for (size_t i = 0; i < bits.size(); ++i) bits[i] &= ~o.bits[i];
+		return *this;
+	}
+	BitSet operator~() const {
+		BitSet ret(*this);
+		for (auto &word: ret.bits) word = ~word;
+		ret.trim();
+		return ret;
+	}
+	friend BitSet operator&(BitSet a, BitSet const &b) { return a &= b; }
+	friend BitSet operator|(BitSet a, BitSet const &b) { return a |= b; }
+	friend BitSet operator-(BitSet a, BitSet const &b) { return a -= b; }
+	bool operator==(BitSet const &o) const { return bits == o.bits; }
+};
+
+class LazyCodeMotion {
+	Wrapper &env;
+	Function *func;
+
+public:
+	LazyCodeMotion(Wrapper &wrapper, Function *function) : env(wrapper), func(function) {}
+	/// @return whether stack slots were introduced
+	bool work();
+
+private:
+	std::vector<Expr> exprs;
+	std::map<Expr, int> index;
+	std::vector<Stmt *> sample;
+	std::map<BasicBlock *, std::map<int, Stmt *>> upward;// first occurrence not preceded by a def of an operand
+
+	std::vector<BasicBlock *> blocks;
+	std::map<BasicBlock *, std::vector<BasicBlock *>> successors, predecessors;
+	std::map<BasicBlock *, BitSet> use, kill;
+	std::map<BasicBlock *, BitSet> antIn, antOut, avIn, avOut, earliest, postIn, postOut, latest, usedIn, usedOut;
+
+	void split_critical_edges();
+	void collect();
+	void solve();
+	bool transform();
+
+	[[nodiscard]] BitSet empty() const { return BitSet(exprs.size()); }
+	[[nodiscard]] BitSet full() const { return BitSet(exprs.size(), true); }
+};
+
+void remove_dead_phis(Function *func) {
+	std::map<Var *, PhiStmt *> phiOf;
+	for (auto block: func->blocks)
+		for (auto [res, phi]: block->phis)
+			phiOf[res] = phi;
+	std::set<PhiStmt *> live;
+	std::queue<PhiStmt *> q;
+	auto mark = [&](Val *val) {
+		if (auto var = dynamic_cast<Var *>(val))
+			if (auto p = phiOf.find(var); p != phiOf.end() && live.insert(p->second).second)
+				q.push(p->second);
+	};
+	for (auto block: func->blocks)
+		for (auto stmt: block->stmts)
+			for (auto val: stmt->getUse())
+				mark(val);
+	while (!q.empty()) {
+		auto phi = q.front();
+		q.pop();
+		for (auto [from, val]: phi->branches)
+			mark(val);
+	}
+	for (auto block: func->blocks)
+		std::erase_if(block->phis, [&](auto const &p) { return !live.contains(p.second); });
+}
+
+}// namespace
+
+void PRE::work() {
+	bool changed = false;
+	auto module = env.get_module();
+	for (auto function: module->functions)
+		if (!function->blocks.empty())
+			changed |= LazyCodeMotion(env, function).work();
+	if (!changed) return;
+	// Mem2Reg also lets ConstFold fold the split blocks nothing was inserted into
+	Mem2Reg(env).work();
+	for (auto function: module->functions)
+		remove_dead_phis(function);
+}
+
+bool LazyCodeMotion::work() {
+	split_critical_edges();
+	CFG cfg(func);
+	blocks = cfg.rpo;
+	successors = cfg.successors;
+	predecessors = cfg.predecessors;
+	collect();
+	// the bit vectors are |blocks| * |exprs|, give up on huge functions
+	if (exprs.empty() || blocks.size() * exprs.size() > (1u << 25))
+		return false;
+	solve();
+	return transform();
+}
+
+void LazyCodeMotion::split_critical_edges() {
+	// lazy code motion places computations on edges, so every critical edge gets a block of its own.
+	// unused ones are folded back by ConstFold, InstMake splits the remaining phi edges itself.
+	CFG cfg(func);
+	std::vector<BasicBlock *> newBlocks;
+	for (auto block: func->blocks) {
+		newBlocks.push_back(block);
+		auto br = block->stmts.empty() ? nullptr : dynamic_cast<CondBrStmt *>(block->stmts.back());
+		if (!br || br->trueBlock == br->falseBlock) continue;
+		BasicBlock *target[2] = {br->trueBlock, br->falseBlock};
+		bool split = false;
+		for (auto &to: target) {
+			if (cfg.predecessors[to].size() < 2) continue;
+			auto middle = env.create_annoy_block("pre_split_");
+			middle->stmts.push_back(env.createDirectBrStmt(to));
+			for (auto [res, phi]: to->phis)
+				if (auto p = phi->branches.find(block); p != phi->branches.end()) {
+					phi->branches[middle] = p->second;
+					phi->branches.erase(p);
+				}
+			newBlocks.push_back(middle);
+			to = middle;
+			split = true;
+		}
+		if (split)
+			block->stmts.back() = env.createCondBrStmt(br->cond, target[0], target[1]);
+	}
+	func->blocks.swap(newBlocks);
+}
+
+void LazyCodeMotion::collect() {
+	std::map<Var *, BasicBlock *> defBlock;
+	for (auto block: blocks) {
+		for (auto [res, phi]: block->phis)
+			defBlock[res] = block;
+		for (auto stmt: block->stmts)
+			if (auto def = stmt->getDef())
+				defBlock[def] = block;
+	}
+	for (auto block: blocks)
+		for (auto stmt: block->stmts) {
+			auto expr = expression_of(stmt);
+			if (!expr) continue;
+			auto [it, fresh] = index.emplace(*expr, static_cast<int>(exprs.size()));
+			if (fresh) {
+				exprs.push_back(*expr);
+				sample.push_back(stmt);
+			}
+			bool exposed = true;
+			for (auto op: expr->second)
+				if (auto var = dynamic_cast<Var *>(op); var && defBlock[var] == block)
+					exposed = false;
+			if (exposed)
+				upward[block].emplace(it->second, stmt);
+		}
+	for (auto block: blocks) {
+		use[block] = empty();
+		kill[block] = empty();
+		for (auto [id, stmt]: upward[block])
+			use[block].set(id);
+	}
+	for (size_t id = 0; id < exprs.size(); ++id)
+		for (auto op: exprs[id].second)
+			if (auto var = dynamic_cast<Var *>(op))
+				if (auto p = defBlock.find(var); p != defBlock.end() && p->second)
+					kill[p->second].set(id);
+}
+
+void LazyCodeMotion::solve() {
+	auto entry = func->blocks.front();
+	bool changed;
+	// anticipated expressions, backward
+	for (auto block: blocks)
+		antIn[block] = full(), antOut[block] = empty();
+	do {
+		changed = false;
+		for (auto block: std::ranges::reverse_view(blocks)) {
+			auto out = successors[block].empty() ? empty() : full();
+			for (auto succ: successors[block])
+				out &= antIn[succ];
+			auto in = use[block] | (out - kill[block]);
+			changed |= !(in == antIn[block]);
+			antOut[block] = out, antIn[block] = in;
+		}
+	} while (changed);
+	// available expressions, assuming the anticipated ones are computed, forward
+	for (auto block: blocks)
+		avIn[block] = empty(), avOut[block] = full();
+	do {
+		changed = false;
+		for (auto block: blocks) {
+			auto in = block == entry ? empty() : full();
+			for (auto pred: predecessors[block])
+				if (avOut.contains(pred)) in &= avOut[pred];
+			auto out = (antIn[block] | in) - kill[block];
+			changed |= !(out == avOut[block]);
+			avIn[block] = in, avOut[block] = out;
+		}
+	} while (changed);
+	for (auto block: blocks)
+		earliest[block] = antIn[block] - avIn[block];
+	// postponable expressions, forward
+	for (auto block: blocks)
+		postIn[block] = empty(), postOut[block] = full();
+	do {
+		changed = false;
+		for (auto block: blocks) {
+			auto in = block == entry ? empty() : full();
+			for (auto pred: predecessors[block])
+				if (postOut.contains(pred)) in &= postOut[pred];
+			auto out = (earliest[block] | in) - use[block];
+			changed |= !(out == postOut[block]);
+			postIn[block] = in, postOut[block] = out;
+		}
+	} while (changed);
+	for (auto block: blocks) {
+		auto all = full();
+		for (auto succ: successors[block])
+			all &= earliest[succ] | postIn[succ];
+		latest[block] = (earliest[block] | postIn[block]) & (use[block] | ~all);
+	}
+	// used expressions, backward
+	for (auto block: blocks)
+		usedIn[block] = empty(), usedOut[block] = empty();
+	do {
+		changed = false;
+		for (auto block: std::ranges::reverse_view(blocks)) {
+			auto out = empty();
+			for (auto succ: successors[block])
+				out |= usedIn[succ];
+			auto in = (use[block] | out) - latest[block];
+			changed |= !(in == usedIn[block]) || !(out == usedOut[block]);
+			usedIn[block] = in, usedOut[block] = out;
+		}
+	} while (changed);
+}
+
+bool LazyCodeMotion::transform() {
+	std::map<int, PtrVar *> slot;
+	auto get_slot = [&](int id) {
+		if (auto p = slot.find(id); p != slot.end())
+			return p->second;
+		auto type = sample[id]->getDef()->type;
+		return slot[id] = env.create_annoy_ptr_var(type, ".pre.");
+	};
+	auto clone = [&](size_t id) -> Stmt * {
+		auto stmt = sample[id];
+		auto old = stmt->getDef();
+		Var *res;
+		if (auto ptr = dynamic_cast<PtrVar *>(old))
+			res = env.create_annoy_ptr_var(ptr->objType, ".pre.val.");
+		else
+			res = env.create_annoy_var(old->type, ".pre.val.");
+		if (auto arith = dynamic_cast<ArithmeticStmt *>(stmt))
+			return env.createArithmeticStmt(arith->cmd, res, arith->lhs, arith->rhs);
+		if (auto icmp = dynamic_cast<IcmpStmt *>(stmt))
+			return env.createIcmpStmt(icmp->cmd, res, icmp->lhs, icmp->rhs);
+		if (auto select = dynamic_cast<SelectStmt *>(stmt))
+			return env.createSelectStmt(res, select->cond, select->trueVal, select->falseVal);
+		auto gep = dynamic_cast<GetElementPtrStmt *>(stmt);
+		return env.createGetElementPtrStmt(gep->typeName, res, gep->pointer, gep->indices);
+	};
+
+	for (auto block: blocks) {
+		auto insert = latest[block] & usedOut[block];
+		auto pos = block->stmts.begin();
+		while (dynamic_cast<AllocaStmt *>(*pos)) ++pos;
+		for (size_t id = 0; id < exprs.size(); ++id) {
+			if (!insert.test(id)) continue;
+			auto stmt = clone(id);
+			block->stmts.insert(pos, stmt);
+			block->stmts.insert(pos, env.createStoreStmt(stmt->getDef(), get_slot(id)));
+		}
+		auto replace = use[block] & (~latest[block] | usedOut[block]);
+		for (auto [id, stmt]: upward[block]) {
+			if (!replace.test(id)) continue;
+			auto p = std::find(block->stmts.begin(), block->stmts.end(), stmt);
+			*p = env.createLoadStmt(stmt->getDef(), get_slot(id));
+		}
+	}
+	if (slot.empty()) return false;
+	auto entry = func->blocks.front();
+	for (auto [id, ptr]: slot)
+		entry->stmts.push_front(env.createAllocaStmt(ptr));
+	return true;
+}
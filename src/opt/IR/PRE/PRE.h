@@ -0,0 +1,18 @@
+#pragma once
+#include "IR/Wrapper.h"
+
+namespace IR {
+
+/// @brief partial redundancy elimination by lazy code motion (Knoop, Ruthing, Steffen).
+/// computations are inserted at the latest points making later ones fully redundant, never adding work to a path.
+/// the result is carried through a stack slot and put back into SSA by Mem2Reg.
+class PRE {
+public:
+	explicit PRE(Wrapper &env) : env(env) {}
+	void work();
+
+private:
+	Wrapper &env;
+};
+
+}// namespace IR
@@ -0,0 +1,229 @@
+#include "SCCP.h"
+#include "opt/IR/Analysis/CFG.h"
+#include "opt/IR/ConstFold/ConstFold.h"
+#include <map>
+#include <queue>
+#include <set>
+
+using namespace IR;
+
+namespace {
+
+struct Lattice {
+	enum State { Top,
+				 Const,
+				 Bottom } state = Top;
+	int value = 0;
+	bool operator==(Lattice const &other) const { return state == other.state && (state != Const || value == other.value); }
+};
+
+class Propagator : private IRBaseVisitor {
+	Wrapper &env;
+	Function *func;
+
+public:
+	Propagator(Wrapper &wrapper, Function *function) : env(wrapper), func(function), cfg(function) {}
+	void work();
+
+private:
+	CFG cfg;
+	std::map<Var *, Lattice> value;
+	std::map<Var *, std::vector<Stmt *>> usage;
+	std::map<Stmt *, BasicBlock *> belong;
+
+	std::set<BasicBlock *> executable;
+	std::set<std::pair<BasicBlock *, BasicBlock *>> executableEdge;
+	std::queue<std::pair<BasicBlock *, BasicBlock *>> edgeQueue;
+	std::queue<Stmt *> stmtQueue;
+
+private:
+	void init();
+	void propagate();
+	void rewrite();
+
+	Lattice get(Val *val);
+	void update(Var *var, Lattice val);
+	void add_edge(BasicBlock *from, BasicBlock *to);
+
+	void visitArithmeticStmt(ArithmeticStmt *node) override;
+	void visitIcmpStmt(IcmpStmt *node) override;
+	void visitSelectStmt(SelectStmt *node) override;
+	void visitPhiStmt(PhiStmt *node) override;
+	void visitCondBrStmt(CondBrStmt *node) override;
+	void visitAllocaStmt(AllocaStmt *node) override { update(node->res, {Lattice::Bottom}); }
+	void visitLoadStmt(LoadStmt *node) override { update(node->res, {Lattice::Bottom}); }
+	void visitGetElementPtrStmt(GetElementPtrStmt *node) override { update(node->res, {Lattice::Bottom}); }
+	void visitCallStmt(CallStmt *node) override {
+		if (node->res) update(node->res, {Lattice::Bottom});
+	}
+};
+
+}// namespace
+
+void SCCP::work() {
+	auto module = env.get_module();
+	for (auto function: module->functions)
+		if (!function->blocks.empty())
+			Propagator(env, function).work();
+	// cut the edges whose condition became literal, and drop the blocks left unreachable
+	ConstFold(env).work();
+}
+
+void Propagator::work() {
+	init();
+	propagate();
+	rewrite();
+}
+
+void Propagator::init() {
+	auto deal_stmt = [&](Stmt *stmt, BasicBlock *block) {
+		belong[stmt] = block;
+		for (auto use: stmt->getUse())
+			if (auto var = dynamic_cast<Var *>(use))
+				usage[var].push_back(stmt);
+		if (auto def = stmt->getDef())
+			value[def] = {Lattice::Top};
+	};
+	for (auto block: func->blocks) {
+		for (auto [var, phi]: block->phis)
+			deal_stmt(phi, block);
+		for (auto stmt: block->stmts)
+			deal_stmt(stmt, block);
+	}
+}
+
+void Propagator::propagate() {
+	edgeQueue.emplace(nullptr, func->blocks.front());
+	while (!edgeQueue.empty() || !stmtQueue.empty()) {
+		while (!edgeQueue.empty()) {
+			auto edge = edgeQueue.front();
+			edgeQueue.pop();
+			if (!executableEdge.insert(edge).second)
+				continue;
+			auto block = edge.second;
+			for (auto [var, phi]: block->phis)
+				visit(phi);
+			if (!executable.insert(block).second)
+				continue;
+			for (auto stmt: block->stmts)
+				if (auto dir = dynamic_cast<DirectBrStmt *>(stmt))
+					add_edge(block, dir->block);// may be shared between blocks, `belong` is not reliable
+				else
+					visit(stmt);
+		}
+		while (!stmtQueue.empty()) {
+			auto stmt = stmtQueue.front();
+			stmtQueue.pop();
+			if (executable.contains(belong[stmt]))
+				visit(stmt);
+		}
+	}
+}
+
+void Propagator::rewrite() {
+	for (auto block: func->blocks) {
+		if (executable.contains(block)) continue;
+		// never reached: drop its incoming values and let ConstFold delete it
+		for (auto succ: cfg.successors[block])
+			for (auto [var, phi]: succ->phis)
+				phi->branches.erase(block);
+		block->stmts.back() = env.createUnreachableStmt();
+	}
+	std::map<Var *, Val *> constant;
+	for (auto [var, val]: value) {
+		if (val.state != Lattice::Const) continue;
+		if (var->type == env.boolType)
+			constant[var] = env.get_literal_bool(val.value);
+		else if (var->type == env.intType)
+			constant[var] = env.get_literal_int(val.value);
+	}
+	for (auto [var, lit]: constant)
+		for (auto stmt: usage[var])
+			stmt->replaceUse(var, lit);
+	for (auto block: func->blocks) {
+		std::erase_if(block->phis, [&](auto const &p) { return constant.contains(p.first); });
+		std::erase_if(block->stmts, [&](Stmt *stmt) {
+			auto def = stmt->getDef();
+			return def && constant.contains(def) && (dynamic_cast<ArithmeticStmt *>(stmt) || dynamic_cast<IcmpStmt *>(stmt) || dynamic_cast<SelectStmt *>(stmt));
+		});
+	}
+}
+
+Lattice Propagator::get(Val *val) {
+	if (auto lit = dynamic_cast<LiteralInt *>(val))
+		return {Lattice::Const, lit->value};
+	if (auto lit = dynamic_cast<LiteralBool *>(val))
+		return {Lattice::Const, lit->value};
+	if (auto var = dynamic_cast<Var *>(val))
+		if (auto p = value.find(var); p != value.end())
+			return p->second;
+	// parameters, globals, null and string literals
+	return {Lattice::Bottom};
+}
+
+void Propagator::update(Var *var, Lattice val) {
+	auto &old = value[var];
+	if (old.state == Lattice::Bottom || val.state == Lattice::Top || old == val) return;
+	if (old.state == Lattice::Const)
+		val = {Lattice::Bottom};// two different constants
+	old = val;
+	for (auto stmt: usage[var])
+		stmtQueue.push(stmt);
+}
+
+void Propagator::add_edge(BasicBlock *from, BasicBlock *to) {
+	if (!executableEdge.contains({from, to}))
+		edgeQueue.emplace(from, to);
+}
+
+void Propagator::visitArithmeticStmt(ArithmeticStmt *node) {
+	auto lhs = get(node->lhs), rhs = get(node->rhs);
+	if (lhs.state == Lattice::Bottom || rhs.state == Lattice::Bottom)
+		update(node->res, {Lattice::Bottom});
+	else if (lhs.state == Lattice::Const && rhs.state == Lattice::Const)
+		update(node->res, {Lattice::Const, calc_arithmetic(node->cmd, lhs.value, rhs.value)});
+}
+
+void Propagator::visitIcmpStmt(IcmpStmt *node) {
+	auto lhs = get(node->lhs), rhs = get(node->rhs);
+	if (lhs.state == Lattice::Bottom || rhs.state == Lattice::Bottom)
+		update(node->res, {Lattice::Bottom});
+	else if (lhs.state == Lattice::Const && rhs.state == Lattice::Const)
+		update(node->res, {Lattice::Const, calc_icmp(node->cmd, lhs.value, rhs.value)});
+}
+
+void Propagator::visitSelectStmt(SelectStmt *node) {
+	auto cond = get(node->cond), t = get(node->trueVal), f = get(node->falseVal);
+	if (cond.state == Lattice::Top) return;
+	if (cond.state == Lattice::Const)
+		update(node->res, cond.value ? t : f);
+	else if (t.state == Lattice::Bottom || f.state == Lattice::Bottom)
+		update(node->res, {Lattice::Bottom});
+	else if (t.state == Lattice::Const && f.state == Lattice::Const)
+		update(node->res, t == f ? t : Lattice{Lattice::Bottom});
+}
+
+void Propagator::visitPhiStmt(PhiStmt *node) {
+	auto block = belong[node];
+	Lattice res{Lattice::Top};
+	for (auto [from, val]: node->branches) {
+		if (!executableEdge.contains({from, block})) continue;
+		auto v = get(val);
+		if (v.state == Lattice::Top) continue;
+		if (res.state == Lattice::Top)
+			res = v;
+		else if (!(res == v))
+			res = {Lattice::Bottom};
+	}
+	update(node->res, res);
+}
+
+void Propagator::visitCondBrStmt(CondBrStmt *node) {
+	auto block = belong[node];
+	auto cond = get(node->cond);
+	// a condition that is still undefined is treated as unknown, which is always safe
+	if (cond.state != Lattice::Const || cond.value)
+		add_edge(block, node->trueBlock);
+	if (cond.state != Lattice::Const || !cond.value)
+		add_edge(block, node->falseBlock);
+}
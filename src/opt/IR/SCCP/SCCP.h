@@ -0,0 +1,17 @@
+#pragma once
+#include "IR/Wrapper.h"
+
+namespace IR {
+
+/// @brief sparse conditional constant propagation (Wegman-Zadeck).
+/// constants are substituted, never-taken edges and blocks are handed to ConstFold for removal.
+class SCCP {
+public:
+	explicit SCCP(Wrapper &env) : env(env) {}
+	void work();
+
+private:
+	Wrapper &env;
+};
+
+}// namespace IR
@@ -0,0 +1,106 @@
+#include "Sink.h"
+#include "opt/IR/Analysis/CFG.h"
+#include "opt/IR/Analysis/DomTree.h"
+#include "opt/IR/Analysis/LoopInfo.h"
+#include <map>
+#include <ranges>
+#include <set>
+
+using namespace IR;
+
+namespace {
+
+/// @brief a use in `user`, or in the edge from `pred` for a phi
+struct Use {
+	Stmt *user;
+	BasicBlock *pred;
+};
+
+class Sinker {
+	Function *func;
+	CFG cfg;
+	DomTree dom;
+	LoopInfo info;
+	std::map<Var *, std::vector<Use>> uses;
+	std::map<Stmt *, BasicBlock *> blockOf;
+
+public:
+	explicit Sinker(Function *func) : func(func), cfg(func), dom(cfg), info(cfg) {}
+	void work();
+
+private:
+	[[nodiscard]] BasicBlock *common_dominator(BasicBlock *a, BasicBlock *b) const {
+		while (!dom.dominates(a, b)) a = dom.idom.at(a);
+		return a;
+	}
+	[[nodiscard]] BasicBlock *target_of(Stmt *stmt, BasicBlock *block) const;
+};
+
+bool sinkable(Stmt *stmt) {
+	return dynamic_cast<ArithmeticStmt *>(stmt) || dynamic_cast<IcmpStmt *>(stmt) ||
+		   dynamic_cast<SelectStmt *>(stmt) || dynamic_cast<GetElementPtrStmt *>(stmt);
+}
+
+}// namespace
+
+void Sink::work() {
+	for (auto func: env.get_module()->functions)
+		if (!func->blocks.empty())
+			Sinker(func).work();
+}
+
+void Sinker::work() {
+	for (auto block: func->blocks) {
+		for (auto [res, phi]: block->phis)
+			for (auto [pred, val]: phi->branches)
+				if (auto var = dynamic_cast<Var *>(val)) uses[var].push_back({phi, pred});
+		for (auto stmt: block->stmts) {
+			blockOf[stmt] = block;
+			for (auto val: stmt->getUse())
+				if (auto var = dynamic_cast<Var *>(val)) uses[var].push_back({stmt, nullptr});
+		}
+	}
+
+	// children before parents and the last stmt of a block first, so that users have already sunk
+	for (auto block: std::views::reverse(dom.preorder())) {
+		for (auto it = block->stmts.rbegin(); it != block->stmts.rend();) {
+			auto stmt = *it;
+			auto target = sinkable(stmt) ? target_of(stmt, block) : nullptr;
+			if (!target) {
+				++it;
+				continue;
+			}
+			it = std::make_reverse_iterator(block->stmts.erase(std::next(it).base()));
+
+			std::set<Stmt *> users;
+			for (auto use: uses[stmt->getDef()])
+				if (!use.pred) users.insert(use.user);
+			auto pos = std::ranges::find_if(target->stmts, [&](Stmt *s) { return users.contains(s); });
+			if (pos == target->stmts.end()) pos = std::prev(pos);
+			target->stmts.insert(pos, stmt);
+			blockOf[stmt] = target;
+		}
+	}
+}
+
+BasicBlock *Sinker::target_of(Stmt *stmt, BasicBlock *block) const {
+	auto p = uses.find(stmt->getDef());
+	if (p == uses.end()) return nullptr;// dead, ADCE removes it
+	BasicBlock *lca = nullptr;
+	for (auto [user, pred]: p->second) {
+		auto at = pred ? pred : blockOf.at(user);
+		if (!dom.contains(at)) continue;
+		lca = lca ? common_dominator(lca, at) : at;
+	}
+	if (!lca || lca == block) return nullptr;
+
+	// loop depth stands for how often a block runs; entering a loop `block` is not in is not allowed
+	BasicBlock *best = nullptr;
+	int bestDepth = info.depth(block);
+	for (auto at = lca; at != block; at = dom.idom.at(at)) {
+		auto loop = info.loopOf.find(at);
+		if (loop != info.loopOf.end() && !loop->second->contains(block)) continue;
+		if (int depth = info.depth(at); !best || depth < bestDepth) best = at, bestDepth = depth;
+	}
+	return best;
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include "IR/Wrapper.h"
+
+namespace IR {
+
+/// @brief code sinking.
+/// a side effect free stmt moves down the dominator tree to the block, among those dominating all its uses,
+/// that runs least often; it never moves into a loop, so no path computes it more often than before.
+class Sink {
+public:
+	explicit Sink(Wrapper &env) : env(env) {}
+	void work();
+
+private:
+	Wrapper &env;
+};
+
+}// namespace IR
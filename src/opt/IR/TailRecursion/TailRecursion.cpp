@@ -0,0 +1,85 @@
+#include "TailRecursion.h"
+#include "IR/Cloner.h"
+#include "opt/IR/Analysis/CFG.h"
+#include <algorithm>
+
+using namespace IR;
+
+namespace {
+
+/// @return the call of `func` ending `block` whose result is returned right away
+CallStmt *tail_call(Function *func, BasicBlock *block) {
+	if (block->stmts.size() < 2) return nullptr;
+	auto call = dynamic_cast<CallStmt *>(*std::prev(block->stmts.end(), 2));
+	if (!call || call->func != func) return nullptr;
+	auto last = block->stmts.back();
+	if (auto ret = dynamic_cast<RetStmt *>(last))
+		return !ret->value || ret->value == call->res ? call : nullptr;
+	// a void function may share its return
+	if (auto br = dynamic_cast<DirectBrStmt *>(last)) {
+		auto to = br->block;
+		auto ret = to->phis.empty() && to->stmts.size() == 1 ? dynamic_cast<RetStmt *>(to->stmts.front()) : nullptr;
+		return ret && !ret->value ? call : nullptr;
+	}
+	return nullptr;
+}
+
+/// @brief entry: stmts becomes
+/// entry: br H
+/// H: the parameters as phis of the arguments, stmts
+/// and a block ending in a tail call goes to H instead
+void eliminate(Wrapper &env, Function *func) {
+	std::vector<BasicBlock *> sites;
+	for (auto block: func->blocks) {
+		if (tail_call(func, block)) sites.push_back(block);
+		for (auto stmt: block->stmts)
+			if (dynamic_cast<AllocaStmt *>(stmt)) return;
+	}
+	if (sites.empty()) return;
+
+	auto entry = func->blocks.front();
+	auto header = env.create_annoy_block("tail_rec_");
+	header->stmts.splice(header->stmts.end(), entry->stmts);
+	entry->stmts.push_back(env.createDirectBrStmt(header));
+	for (auto succ: successors_of(header))
+		for (auto [res, phi]: succ->phis)
+			if (auto p = phi->branches.find(entry); p != phi->branches.end()) {
+				phi->branches[header] = p->second;
+				phi->branches.erase(p);
+			}
+	func->blocks.insert(std::next(func->blocks.begin()), header);
+	std::ranges::replace(sites, entry, header);
+
+	Cloner params(env, ".tail.");
+	for (auto param: func->paramsVar)
+		params.fresh(param);
+	for (auto block: func->blocks) {
+		for (auto [res, phi]: block->phis)
+			for (auto [from, to]: params.val)
+				phi->replaceUse(from, to);
+		for (auto stmt: block->stmts)
+			for (auto [from, to]: params.val)
+				stmt->replaceUse(from, to);
+	}
+	std::vector<PhiStmt *> phis;
+	for (auto param: func->paramsVar) {
+		auto res = params(param);
+		phis.push_back(header->phis[res] = env.createPhiStmt(res, std::map<BasicBlock *, Val *>{{entry, param}}));
+	}
+	for (auto site: sites) {
+		auto call = tail_call(func, site);
+		for (size_t i = 0; i < phis.size(); ++i)
+			phis[i]->branches[site] = call->args[i];
+		site->stmts.pop_back();
+		site->stmts.pop_back();
+		site->stmts.push_back(env.createDirectBrStmt(header));
+	}
+}
+
+}// namespace
+
+void TailRecursion::work() {
+	for (auto func: env.get_module()->functions)
+		if (!func->blocks.empty())
+			eliminate(env, func);
+}
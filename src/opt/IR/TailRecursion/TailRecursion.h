@@ -0,0 +1,18 @@
+#pragma once
+#include "IR/Wrapper.h"
+
+namespace IR {
+
+/// @brief tail recursion elimination.
+/// a function returning what it calls itself with jumps back to its start instead, its parameters become phis of the
+/// arguments there. calls in tail position to other functions are left to the backend.
+class TailRecursion {
+public:
+	explicit TailRecursion(Wrapper &env) : env(env) {}
+	void work();
+
+private:
+	Wrapper &env;
+};
+
+}// namespace IR
@@ -0,0 +1,49 @@
+#include "VRP.h"
+#include "opt/IR/Analysis/Range.h"
+#include "opt/IR/ConstFold/ConstFold.h"
+#include <map>
+#include <optional>
+
+using namespace IR;
+
+void VRP::work() {
+	auto module = env.get_module();
+	RangeAnalysis ranges(module);
+	for (auto func: module->functions) {
+		std::map<Var *, IcmpStmt *> icmpOf;
+		std::map<Val *, Val *> known;
+		for (auto block: func->blocks)
+			for (auto stmt: block->stmts)
+				if (auto icmp = dynamic_cast<IcmpStmt *>(stmt)) {
+					icmpOf[icmp->res] = icmp;
+					if (auto res = ranges.outcome(icmp, block))
+						known[icmp->res] = env.get_literal_bool(*res);
+				}
+		for (auto block: func->blocks) {
+			std::erase_if(block->stmts, [&](Stmt *stmt) {
+				auto icmp = dynamic_cast<IcmpStmt *>(stmt);
+				return icmp && known.contains(icmp->res);
+			});
+			for (auto [res, phi]: block->phis)
+				for (auto use: phi->getUse())
+					if (known.contains(use)) phi->replaceUse(use, known[use]);
+			for (auto stmt: block->stmts)
+				for (auto use: stmt->getUse())
+					if (known.contains(use)) stmt->replaceUse(use, known[use]);
+			// a guard implied by the conditions dominating the branch
+			auto br = dynamic_cast<CondBrStmt *>(block->stmts.back());
+			if (!br) continue;
+			std::optional<bool> taken;
+			if (auto lit = dynamic_cast<LiteralBool *>(br->cond))
+				taken = lit->value;
+			else if (auto p = icmpOf.find(dynamic_cast<Var *>(br->cond)); p != icmpOf.end())
+				taken = ranges.outcome(p->second, block);
+			if (!taken || br->trueBlock == br->falseBlock) continue;
+			auto to = *taken ? br->trueBlock : br->falseBlock, other = *taken ? br->falseBlock : br->trueBlock;
+			for (auto [res, phi]: other->phis)
+				phi->branches.erase(block);
+			block->stmts.back() = env.createDirectBrStmt(to);
+		}
+	}
+	ConstFold(env).work();
+}
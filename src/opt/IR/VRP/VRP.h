@@ -0,0 +1,18 @@
+#pragma once
+#include "IR/Wrapper.h"
+
+namespace IR {
+
+/// @brief value range propagation.
+/// an icmp whose outcome follows from the ranges of its operands becomes a literal, and a branch whose condition is
+/// known where it is taken becomes a jump; ConstFold then removes the blocks left unreachable.
+class VRP {
+public:
+	explicit VRP(Wrapper &env) : env(env) {}
+	void work();
+
+private:
+	Wrapper &env;
+};
+
+}// namespace IR
@@ -1,4 +1,7 @@
+#pragma once
+#include <algorithm>
 #include <functional>
+#include <vector>
 
 struct Graph {
 	int n = 0;
@@ -133,4 +136,62 @@ struct DominanceFrontier {
 			out[y].insert(out[y].end(), out[x].begin(), out[x].end());
 		}
 	}
-};
\ No newline at end of file
+};
+
+/// @brief natural loops: an edge x -> h is a back edge if h dominates x, back edges into one header form one loop
+struct LoopForest {
+	Graph &G;
+	DominateTree &dom;
+	std::vector<int> header;// innermost loop containing x, 0 if none; a header is inside its own loop
+	std::vector<int> parent;// for a header, the header of the enclosing loop
+	std::vector<int> depth; // number of loops containing x
+	std::vector<std::vector<int>> latches, body;// indexed by header
+
+	LoopForest(Graph &g, DominateTree &t) : G(g), dom(t), header(g.n + 1), parent(g.n + 1), depth(g.n + 1), latches(g.n + 1), body(g.n + 1) {}
+	void work(int entry) {
+		int n = G.n;
+		Graph tree(n);
+		for (int x = 1; x <= n; ++x)
+			if (dom.idom[x] != 0 && x != entry)
+				tree.add_edge(dom.idom[x], x);
+		GraphDfn gdfn(tree);
+		gdfn.dfs(entry);
+		auto &dfn = gdfn.dfn;
+		auto &siz = gdfn.size;
+		auto dominates = [&](int a, int b) { return dfn[a] && dfn[b] && dfn[a] <= dfn[b] && dfn[b] < dfn[a] + siz[a]; };
+
+		std::vector<int> headers;
+		for (int x = 1; x <= n; ++x)
+			for (auto y: G[x])
+				if (dominates(y, x)) {
+					if (latches[y].empty()) headers.push_back(y);
+					latches[y].push_back(x);
+				}
+		Graph Z = G.InverseGraph();
+		std::vector<int> mark(n + 1);
+		for (auto h: headers) {
+			mark[h] = h;
+			body[h].push_back(h);
+			std::vector<int> stack;
+			for (auto x: latches[h])
+				if (mark[x] != h) mark[x] = h, stack.push_back(x);
+			while (!stack.empty()) {
+				int x = stack.back();
+				stack.pop_back();
+				body[h].push_back(x);
+				for (auto y: Z[x])
+					if (mark[y] != h && dfn[y]) mark[y] = h, stack.push_back(y);
+			}
+		}
+		// outer loops first, so inner ones overwrite `header`
+		std::ranges::stable_sort(headers, [&](int a, int b) { return body[a].size() > body[b].size(); });
+		for (auto h: headers) {
+			parent[h] = header[h];
+			depth[h] = parent[h] ? depth[parent[h]] + 1 : 1;
+			for (auto x: body[h])
+				header[x] = h;
+		}
+		for (int x = 1; x <= n; ++x)
+			depth[x] = header[x] ? depth[header[x]] : 0;
+	}
+};